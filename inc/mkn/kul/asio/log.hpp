@@ -31,9 +31,31 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _MKN_KUL_ASIO_LOG_HPP_
 #define _MKN_KUL_ASIO_LOG_HPP_
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+
 #include "mkn/kul/log.hpp"
+#include "mkn/kul/signal.hpp"
 #include "mkn/kul/threads.hpp"
 
+#if !KUL_IS_WIN
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifndef __MKN_KUL_ASIO_LOG_RECORD__
+#define __MKN_KUL_ASIO_LOG_RECORD__ 256
+#endif /*  __MKN_KUL_ASIO_LOG_RECORD__ */
+
+#ifndef __MKN_KUL_ASIO_LOG_RING__
+#define __MKN_KUL_ASIO_LOG_RING__ 1024
+#endif /*  __MKN_KUL_ASIO_LOG_RING__ */
+
 namespace mkn {
 namespace kul {
 namespace asio {
@@ -43,32 +65,417 @@ class Exception : public mkn::kul::Exception {
  public:
   Exception(char const *f, uint16_t const &l, std::string const &s) : mkn::kul::Exception(f, l, s) {}
 };
+
+// what a thread does when its ring is full
+enum class Policy { BLOCK = 0, DROP_NEWEST, DROP_OLDEST };
+
+// messages longer than one record continue in the following records
+struct Record {
+  enum : uint8_t { ERR = 1, CONT = 2, MORE = 4, DEFER = 8 };
+  static constexpr size_t SIZE = __MKN_KUL_ASIO_LOG_RECORD__ - 3;
+  static_assert(__MKN_KUL_ASIO_LOG_RECORD__ > 3 && SIZE <= UINT16_MAX, "bad log record size");
+
+  uint16_t len = 0;
+  uint8_t flags = 0;
+  char data[SIZE];
+};
+
+// single producer (the logging thread) single consumer (the drainer) ring of records
+//  under DROP_OLDEST the producer also advances the read index, hence the CAS in pop
+class Ring {
+ private:
+  size_t const mask;
+  alignas(64) std::atomic<size_t> w;
+  alignas(64) std::atomic<size_t> r;
+  std::unique_ptr<Record[]> b;
+
+ public:
+  Ring(size_t const &size) : mask(size - 1), w(0), r(0), b(new Record[size]) {}
+
+  // producer
+  Record *claim() {
+    auto const _w = w.load(std::memory_order_relaxed);
+    if (_w - r.load(std::memory_order_acquire) > mask) return nullptr;
+    return &b[_w & mask];
+  }
+  void publish() { w.store(w.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+  void drop() {
+    auto x = r.load(std::memory_order_acquire);
+    if (w.load(std::memory_order_relaxed) - x > mask)
+      r.compare_exchange_strong(x, x + 1, std::memory_order_acq_rel);
+  }
+
+  // consumer
+  bool pop(Record &rec) {
+    auto x = r.load(std::memory_order_acquire);
+    while (x != w.load(std::memory_order_acquire)) {
+      auto const &c(b[x & mask]);
+      rec.len = c.len;
+      rec.flags = c.flags;
+      std::memcpy(rec.data, c.data, rec.len);
+      if (r.compare_exchange_strong(x, x + 1, std::memory_order_acq_rel)) return true;
+    }
+    return false;
+  }
+  bool empty() const { return r.load() == w.load(); }
+
+  std::string partial;  // drainer only, message spanning records
+  uint8_t flags = 0;
+  bool mid = 0;
+  Ring *next = nullptr;  // every ring of a Logger, for the crash path
+};
+
+// deferred records are a header then tagged arguments, formatted by the drainer
+using mkn::kul::log::arg;
+using mkn::kul::log::put;
+
+inline void header(std::string &b, char const *f, char const *fn, uint16_t const &l,
+                   mkn::kul::log::mode const &m) {
+  put(b, mkn::kul::Now::NANOS());
+  put(b, f);
+  put(b, fn);
+  put(b, l);
+  put(b, int8_t(m));
+  put(b, std::string_view(mkn::kul::log::TID()));
+}
 }  // namespace log
 
 class LogMan;
+
+// each logging thread writes into its own ring, one drainer thread writes them out in batches
 class Logger : public mkn::kul::Logger {
   friend class LogMan;
+  friend class mkn::kul::Thread;
 
  private:
-  mkn::kul::ChroncurrentThreadPool<> ctp;
-  std::function<void(std::string const &)> defE, defO;
+  static constexpr size_t BATCH = 64;
+  using Ring = log::Ring;
+  using Record = log::Record;
+
+  size_t const _id, _records;
+  std::atomic<log::Policy> _policy;
+  std::atomic<bool> _up, _sleeping;
+  std::atomic<size_t> _dropped;
+  std::vector<std::shared_ptr<Ring>> _rings, _drain;
+  std::atomic<Ring *> _all;
+  std::mutex _rmutex, _dmutex, _smutex;
+  std::condition_variable _cv;
+
+  // drainer state, record pieces point into _batch, text pieces into _text
+  struct Piece {
+    bool err, text;
+    size_t off, len;
+  };
+  std::unique_ptr<Record[]> _batch;
+  Piece _pieces[BATCH];
+  size_t _n = 0, _np = 0;
+  std::string _text;
+  std::stringstream _ss;
+  mkn::kul::log::Clock _clock;
+  mkn::kul::Thread _thread;
+
+  static size_t ID() {
+    static std::atomic<size_t> id{0};
+    return ++id;
+  }
+  static std::atomic<Logger *> &CRASH() {
+    static std::atomic<Logger *> l{nullptr};
+    return l;
+  }
+
+  // rings of exited threads are reused rather than freed, so _all only grows. A reused ring goes
+  //  last like a new one would, so a pass drains it after the rings of earlier threads
+  Ring &ring() {
+    static thread_local std::vector<std::pair<size_t, std::shared_ptr<Ring>>> rs;
+    for (auto const &r : rs)
+      if (r.first == _id) return *r.second;
+    std::shared_ptr<Ring> ring;
+    {
+      std::lock_guard<std::mutex> l(_rmutex);
+      for (auto it = _rings.begin(); it != _rings.end(); ++it)
+        if (it->use_count() == 1 && (*it)->empty()) {
+          ring = *it;
+          std::rotate(it, it + 1, _rings.end());
+          break;
+        }
+      if (!ring) {
+        ring = std::make_shared<Ring>(_records);
+        _rings.push_back(ring);
+        ring->next = _all.load(std::memory_order_relaxed);
+        _all.store(ring.get(), std::memory_order_release);
+      }
+    }
+    rs.emplace_back(_id, ring);
+    return *ring;
+  }
+
+  void write(uint8_t flags, char const *s, size_t n) {
+    auto &r(ring());
+    do {
+      Record *rec;
+      while (!(rec = r.claim())) {
+        auto const p = _policy.load(std::memory_order_relaxed);
+        if (p == log::Policy::DROP_NEWEST) {
+          _dropped++;
+          return;
+        }
+        if (p == log::Policy::DROP_OLDEST) {
+          _dropped++;
+          r.drop();
+        } else {
+          wake();
+          std::this_thread::yield();
+        }
+      }
+      auto const k = std::min(n, Record::SIZE);
+      std::memcpy(rec->data, s, k);
+      rec->len = k;
+      rec->flags = flags | (n > k ? Record::MORE : 0);
+      r.publish();
+      s += k;
+      n -= k;
+      flags |= Record::CONT;
+    } while (n);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping) wake();
+  }
+
+  void wake() {
+    { std::lock_guard<std::mutex> l(_smutex); }
+    _cv.notify_one();
+  }
+
+  void emit(bool const err, char const *s, size_t const n) {
+    auto const &f(err ? e : o);
+    if (f) return f(std::string(s, n));
+#if KUL_IS_WIN
+    fwrite(s, 1, n, err ? stderr : stdout);
+#else
+    iovec v{const_cast<char *>(s), n};
+    emit(err, &v, 1);
+#endif
+  }
+
+#if !KUL_IS_WIN
+  void emit(bool const err, iovec *v, size_t n) {
+    if ((err ? e : o)) {
+      for (size_t i = 0; i < n; i++) emit(err, static_cast<char *>(v[i].iov_base), v[i].iov_len);
+      return;
+    }
+    int const fd = err ? 2 : 1;
+    while (n) {
+      auto w = writev(fd, v, n);
+      if (w < 0) {
+        if (errno == EINTR) continue;
+        return;
+      }
+      for (; n && size_t(w) >= v->iov_len; n--, v++) w -= v->iov_len;
+      if (n) {
+        v->iov_base = static_cast<char *>(v->iov_base) + w;
+        v->iov_len -= w;
+      }
+    }
+  }
+#endif
+
+  // writes batched messages in order, grouped by stream
+  void flushBatch() {
+#if KUL_IS_WIN
+    for (size_t i = 0; i < _np; i++) {
+      auto const &p(_pieces[i]);
+      emit(p.err, p.text ? &_text[p.off] : _batch[p.off].data, p.len);
+    }
+#else
+    iovec v[BATCH];
+    for (size_t i = 0, j = 0; i < _np; i = j) {
+      bool const err = _pieces[i].err;
+      for (j = i; j < _np && _pieces[j].err == err; j++) {
+        auto const &p(_pieces[j]);
+        v[j - i] = iovec{p.text ? &_text[p.off] : _batch[p.off].data, p.len};
+      }
+      emit(err, v, j - i);
+    }
+#endif
+    _n = _np = 0;
+    _text.clear();
+  }
+
+  void piece(bool const err, bool const text, size_t const off, size_t const len) {
+    _pieces[_np++] = Piece{err, text, off, len};
+    if (_np == BATCH) flushBatch();
+  }
+  void message(uint8_t const flags, char const *s, size_t const n) {
+    auto const off = _text.size();
+    if (!(flags & Record::DEFER))
+      _text.append(s, n);
+    else if (!decode(s, n))
+      return;
+    piece(flags & Record::ERR, 1, off, _text.size() - off);
+  }
+  void partial(Ring &r) {
+    if (!(r.flags & Record::DEFER) || !(r.flags & Record::MORE))  // truncated deferred are lost
+      message(r.flags, r.partial.data(), r.partial.size());
+    r.partial.clear();
+    r.mid = 0;
+  }
+
+  // rec is _batch[_n]
+  void take(Ring &r, Record &rec) {
+    if (!(rec.flags & (Record::CONT | Record::MORE))) {
+      if (r.mid) partial(r);  // tail of previous message was dropped
+      if (rec.flags & Record::DEFER)
+        message(rec.flags, rec.data, rec.len);
+      else
+        piece(rec.flags & Record::ERR, 0, _n++, rec.len);
+      return;
+    }
+    if (!(rec.flags & Record::CONT)) {
+      if (r.mid) partial(r);
+      r.mid = 1;
+      r.flags = rec.flags;
+    } else if (!r.mid)
+      return;  // head of this message was dropped
+    r.partial.append(rec.data, rec.len);
+    if (!(rec.flags & Record::MORE)) {
+      r.flags &= ~Record::MORE;
+      partial(r);
+    }
+  }
+
+  // appends the formatted deferred record to _text
+  bool decode(char const *p, size_t const n) {
+    mkn::kul::log::Reader rd(p, n);
+    uint64_t ns;
+    char const *f, *fn;
+    uint16_t l;
+    int8_t m;
+    std::string_view tid;
+    if (!rd.get(ns) || !rd.get(f) || !rd.get(fn) || !rd.get(l) || !rd.get(m) || !rd.get(tid))
+      return false;
+    _ss.str("");
+    if (!mkn::kul::log::print(rd, _ss)) return false;
+    mkn::kul::log::Format::DEFAULT().write(_text, f, fn, l, _ss.str(),
+                                           static_cast<mkn::kul::log::mode>(m), tid, _clock.at(ns));
+    _text += mkn::kul::os::EOL();
+    return true;
+  }
+  // returns true if anything was written
+  bool drain() {
+    std::lock_guard<std::mutex> l(_dmutex);
+    {
+      std::lock_guard<std::mutex> r(_rmutex);
+      _drain = _rings;
+    }
+    bool any = 0;
+    for (auto &r : _drain)
+      while (r->pop(_batch[_n])) {
+        any = 1;
+        take(*r, _batch[_n]);
+      }
+    flushBatch();
+    _drain.clear();
+    return any;
+  }
+
+  bool pending() {
+    std::lock_guard<std::mutex> l(_rmutex);
+    for (auto const &r : _rings)
+      if (!r->empty()) return true;
+    return false;
+  }
+
+  void operator()() {
+    size_t idle = 0;
+    while (_up) {
+      if (drain()) {
+        idle = 0;
+        continue;
+      }
+      if (++idle < __MKN_KUL_POOL_SPIN__) {
+        std::this_thread::yield();
+        continue;
+      }
+      std::unique_lock<std::mutex> l(_smutex);
+      _sleeping = 1;
+      _cv.wait_for(l, std::chrono::milliseconds(100), [&]() { return !_up || pending(); });
+      _sleeping = 0;
+      idle = 0;
+    }
+    drain();
+  }
+
+  // signal handler, takes no locks and does not allocate so deferred records are skipped
+  //  custom out/err functions are bypassed
+  void crash() {
+    Record rec;
+    for (Ring *r = _all.load(std::memory_order_acquire); r; r = r->next)
+      while (r->pop(rec)) {
+        if (rec.flags & Record::DEFER) continue;
+#if KUL_IS_WIN
+        fwrite(rec.data, 1, rec.len, rec.flags & Record::ERR ? stderr : stdout);
+#else
+        for (size_t o = 0; o < rec.len;) {
+          auto const w = ::write(rec.flags & Record::ERR ? 2 : 1, rec.data + o, rec.len - o);
+          if (w < 0 && errno == EINTR) continue;
+          if (w <= 0) break;
+          o += w;
+        }
+#endif
+      }
+  }
 
  public:
-  Logger()
-      : ctp(1, 1),
-        defE([&](std::string const &s) { mkn::kul::Logger::err(s); }),
-        defO([&](std::string const &s) { mkn::kul::Logger::out(s); }) {}
-  void err(std::string const &s) override {
-    if (e)
-      ctp.async(std::bind(e, s));
-    else
-      ctp.async(std::bind(defE, s));
-  }
-  void out(std::string const &s) override {
-    if (o)
-      ctp.async(std::bind(o, s));
-    else
-      ctp.async(std::bind(defO, s));
+  // records per thread must be a power of two, strt=0 leaves draining to flush()
+  Logger(log::Policy const &policy = log::Policy::BLOCK,
+         size_t const &records = __MKN_KUL_ASIO_LOG_RING__, bool strt = 1)
+      : _id(ID()),
+        _records(records),
+        _policy(policy),
+        _up(strt),
+        _sleeping(0),
+        _dropped(0),
+        _all(nullptr),
+        _batch(new Record[BATCH]),
+        _thread(std::ref(*this)) {
+    if (records < 2 || (records & (records - 1)))
+      KEXCEPT(log::Exception, "Log ring size must be a power of two");
+    if (strt) _thread.run();
+  }
+  ~Logger() {
+    Logger *self = this;
+    CRASH().compare_exchange_strong(self, nullptr);
+    if (_up) {
+      _up = 0;
+      wake();
+      _thread.join();
+    }
+    drain();
+  }
+
+  void err(std::string const &s) override { write(Record::ERR, s.data(), s.size()); }
+  void out(std::string const &s) override { write(0, s.data(), s.size()); }
+  // a record built by DeferMessage
+  void defer(std::string const &b) { write(Record::DEFER, b.data(), b.size()); }
+
+  Logger &policy(log::Policy const &p) {
+    _policy = p;
+    return *this;
+  }
+  size_t dropped() const { return _dropped; }
+
+  // writes everything logged so far from the calling thread
+  void flush() { drain(); }
+
+  // on SIGSEGV/SIGABRT writes out records not yet drained, applies to the last Logger to call this
+  void flushOnCrash() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+      auto f = [](int16_t) {
+        if (auto *l = CRASH().load()) l->crash();
+      };
+      mkn::kul::Signal().segv(f).abrt(f);
+    });
+    CRASH() = this;
   }
 };
 
@@ -76,11 +483,21 @@ class LogMan : public mkn::kul::ALogMan {
  protected:
   LogMan() : ALogMan(new mkn::kul::asio::Logger()) {}
 
+  Logger &sink() const { return static_cast<Logger &>(*logger); }
+
  public:
   static LogMan &INSTANCE() {
     static LogMan instance;
     return instance;
   };
+  LogMan &policy(log::Policy const &p) {
+    sink().policy(p);
+    return *this;
+  }
+  size_t dropped() const { return sink().dropped(); }
+  void flush() { sink().flush(); }
+  void defer(std::string const &b) { sink().defer(b); }
+  void flushOnCrash() { sink().flushOnCrash(); }
 };
 
 class Message {
@@ -116,10 +533,64 @@ struct ErrMessage : public Message {
   ~ErrMessage() { LogMan::INSTANCE().err(ss.str()); }
 };
 
-#define KASIO_LOG_INF mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::INF)
-#define KASIO_LOG_ERR mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::ERR)
-#define KASIO_LOG_DBG mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::DBG)
-#define KASIO_LOG_TRC mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::TRC)
+// arguments are copied raw into a reused thread local buffer, formatting happens on the drainer
+class DeferMessage {
+ private:
+  bool const on;
+  std::string b;
+
+  static std::string &BUFFER() {
+    static thread_local std::string b;
+    return b;
+  }
+
+ public:
+  DeferMessage(char const *f, char const *fn, uint16_t const &l, const mkn::kul::log::mode &m)
+      : on(LogMan::INSTANCE().enabled(f, m)) {
+    if (!on) return;
+    b = std::move(BUFFER());
+    b.clear();
+    log::header(b, f, fn, l, m);
+  }
+  ~DeferMessage() {
+    if (!on) return;
+    LogMan::INSTANCE().defer(b);
+    BUFFER() = std::move(b);
+  }
+  template <class T>
+  DeferMessage &operator<<(T const &t) {
+    if (on) log::arg(b, t);
+    return *this;
+  }
+};
+
+#if defined(_MKN_KUL_ASIO_LOG_DEFER_)
+#define KASIO_LOG_INF                                                                  \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::INF)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::INF)
+#define KASIO_LOG_ERR                                                                  \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::ERR)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::ERR)
+#define KASIO_LOG_DBG                                                                  \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::DBG)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::DBG)
+#define KASIO_LOG_TRC                                                                  \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::TRC)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::TRC)
+#else
+#define KASIO_LOG_INF                                                                \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::INF)                       \
+  mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::INF)
+#define KASIO_LOG_ERR                                                                \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::ERR)                       \
+  mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::ERR)
+#define KASIO_LOG_DBG                                                                \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::DBG)                       \
+  mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::DBG)
+#define KASIO_LOG_TRC                                                                \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::TRC)                       \
+  mkn::kul::asio::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::TRC)
+#endif
 #define KASIO_LOG(sev) KLOG_##sev
 
 #define KASIO_OUT_NON mkn::kul::asio::OutMessage()
@@ -134,4 +605,35 @@ struct ErrMessage : public Message {
 }  // namespace asio
 }  // namespace kul
 }  // namespace mkn
+
+#if defined(_MKN_KUL_ASIO_LOG_DEFER_) && \
+    (!defined(_MKN_KUL_DISABLE_KLOG_DEF_) || _MKN_KUL_DISABLE_KLOG_DEF_ == 1)
+#undef KLOG_NON
+#undef KLOG_INF
+#undef KLOG_ERR
+#define KLOG_NON                                                                       \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::NON)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::NON)
+#define KLOG_INF                                                                       \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::INF)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::INF)
+#define KLOG_ERR                                                                       \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::ERR)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::ERR)
+#if !defined(NDEBUG)
+#undef KLOG_DBG
+#undef KLOG_OTH
+#undef KLOG_TRC
+#define KLOG_DBG                                                                       \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::DBG)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::DBG)
+#define KLOG_OTH                                                                       \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::OTH)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::OTH)
+#define KLOG_TRC                                                                       \
+  KUL_LOG_IF(mkn::kul::asio::LogMan, mkn::kul::log::mode::TRC)                         \
+  mkn::kul::asio::DeferMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::TRC)
+#endif  // !defined(NDEBUG)
+#endif  // defined(_MKN_KUL_ASIO_LOG_DEFER_)
+
 #endif /* _MKN_KUL_LOG_HPP_ */
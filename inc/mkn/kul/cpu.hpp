@@ -33,6 +33,61 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "mkn/kul/defs.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace mkn {
+namespace kul {
+namespace cpu {
+
+// where pool workers are pinned
+//  COMPACT  - one logical cpu each, filling SMT siblings then cores then sockets
+//  SCATTER  - one logical cpu each, spreading across sockets then cores before SMT siblings
+//  PHYSICAL - one physical core each, free to use any of its SMT siblings
+//  NODE     - round robin over NUMA nodes, free to use any cpu on the node
+enum class Placement { NONE = 0, COMPACT, SCATTER, PHYSICAL, NODE };
+
+// a logical cpu, core is unique across sockets
+struct Cpu {
+  uint32_t id = 0, core = 0, socket = 0, node = 0;
+};
+
+class Topology {
+ private:
+  std::vector<Cpu> cs;
+
+  size_t count(uint32_t Cpu::*m) const {
+    std::set<uint32_t> s;
+    for (auto const &c : cs) s.insert(c.*m);
+    return s.size();
+  }
+
+ public:
+  Topology() {}
+  Topology(std::vector<Cpu> &&_cs) : cs(std::move(_cs)) {}
+
+  // n logical cpus each its own core on one socket and node
+  static Topology FLAT(uint32_t const &n) {
+    std::vector<Cpu> cs(n ? n : 1);
+    for (uint32_t i = 0; i < cs.size(); i++) cs[i].id = cs[i].core = i;
+    return Topology(std::move(cs));
+  }
+
+  std::vector<Cpu> const &cpus() const { return cs; }
+  size_t threads() const { return cs.size(); }
+  size_t cores() const { return count(&Cpu::core); }
+  size_t sockets() const { return count(&Cpu::socket); }
+  size_t nodes() const { return count(&Cpu::node); }
+};
+
+}  // namespace cpu
+}  // namespace kul
+}  // namespace mkn
+
 #if KUL_IS_NIX
 #include "mkn/kul/os/nix/cpu.hpp"
 #elif KUL_IS_BSD
@@ -43,4 +98,58 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #error unresolved
 #endif
 
+namespace mkn {
+namespace kul {
+namespace cpu {
+
+// the logical cpus each of n workers should be pinned to, empty for Placement::NONE
+inline std::vector<std::vector<uint32_t>> place(Placement const &p, size_t const &n,
+                                                Topology const &t) {
+  std::vector<std::vector<uint32_t>> sets(n);
+  auto cs = t.cpus();
+  if (p == Placement::NONE || cs.empty()) return sets;
+  std::sort(cs.begin(), cs.end(), [](Cpu const &a, Cpu const &b) {
+    return std::tie(a.socket, a.core, a.id) < std::tie(b.socket, b.core, b.id);
+  });
+
+  if (p == Placement::COMPACT)
+    for (size_t i = 0; i < n; i++) sets[i] = {cs[i % cs.size()].id};
+  else if (p == Placement::SCATTER) {
+    // sibling rank, then core index within socket, then socket
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>> order;
+    uint32_t rank = 0, index = 0;
+    for (size_t i = 0; i < cs.size(); i++) {
+      if (i && cs[i].socket != cs[i - 1].socket)
+        index = 0, rank = 0;
+      else if (i && cs[i].core != cs[i - 1].core)
+        index++, rank = 0;
+      else if (i)
+        rank++;
+      order.emplace_back(rank, index, cs[i].socket, cs[i].id);
+    }
+    std::sort(order.begin(), order.end());
+    for (size_t i = 0; i < n; i++) sets[i] = {std::get<3>(order[i % order.size()])};
+  } else {
+    // cpus sharing a core, ordered by socket, or a node
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> g;
+    for (auto const &c : cs)
+      g[p == Placement::PHYSICAL ? std::make_pair(c.socket, c.core) : std::make_pair(c.node, 0u)]
+          .push_back(c.id);
+    auto it = g.begin();
+    for (size_t i = 0; i < n; i++, it++) {
+      if (it == g.end()) it = g.begin();
+      sets[i] = it->second;
+    }
+  }
+  return sets;
+}
+inline std::vector<std::vector<uint32_t>> place(Placement const &p, size_t const &n) {
+  if (p == Placement::NONE) return std::vector<std::vector<uint32_t>>(n);
+  return place(p, n, topology());
+}
+
+}  // namespace cpu
+}  // namespace kul
+}  // namespace mkn
+
 #endif  // _MKN_KUL_CPU_HPP_
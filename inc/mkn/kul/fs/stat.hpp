@@ -0,0 +1,285 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_FS_STAT_HPP_
+#define _MKN_KUL_FS_STAT_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/inotify.h>
+#endif
+
+namespace mkn {
+namespace kul {
+namespace fs {
+
+// opt-in memo of stat/realpath by path, used by Dir/File while enabled.
+//  Entries are dropped as inotify reports changes to them, pending events are read before each
+//  lookup so changes which have returned to any process are seen. Every directory above a cached
+//  path is watched so renames and links higher up are caught too. Access times are not tracked.
+//  Linux only, enable() is false elsewhere or if inotify cannot be initialised
+class StatCache {
+ public:
+  struct Stat {
+    bool ok = 0;
+    uint32_t mode = 0;
+    uint64_t size = 0, atime = 0, mtime = 0;
+
+    bool file() const { return ok && S_ISREG(mode); }
+    bool dir() const { return ok && S_ISDIR(mode); }
+  };
+
+ private:
+  struct Entry {
+    bool st = 0, rl = 0;
+    Stat s;
+    std::string real;
+  };
+  struct Node {  // a watched directory
+    int wd = -1;
+    std::unordered_map<std::string, Entry> names;
+    std::unordered_set<std::string> subs;  // child names which are Nodes
+  };
+
+  static std::atomic<bool> &ON() {
+    static std::atomic<bool> b{0};
+    return b;
+  }
+
+  std::mutex m;
+  int fd = -1;
+  std::unordered_map<std::string, Node> dirs;
+  std::unordered_map<int, std::vector<std::string>> wds;
+  std::atomic<size_t> _hits{0}, _misses{0};
+
+  StatCache() {}
+  ~StatCache() { disable(); }
+
+  static Stat STAT(char const *p) {
+    Stat s;
+    struct stat st;
+    if (::stat(p, &st) == 0) {
+      s.ok = 1;
+      s.mode = st.st_mode;
+      s.size = st.st_size;
+      s.atime = st.st_atime;
+      s.mtime = st.st_mtime;
+    }
+    return s;
+  }
+  static bool REAL(char const *p, std::string &r) {
+    char *c = realpath(p, NULL);
+    if (!c) return 0;
+    r = c;
+    free(c);
+    return 1;
+  }
+
+  // absolute and without "//", "/." or a trailing "/"
+  //  ".." is left as it does not resolve lexically
+  static std::string ABS(std::string const &p) {
+    std::string a, s;
+    if (p.empty() || p[0] != '/') {
+      char c[PATH_MAX];
+      if (getcwd(c, sizeof(c))) s = c;
+      s += '/';
+    }
+    s += p;
+    a.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+      if (s[i] == '/' && (!a.empty() && a.back() == '/')) continue;
+      if (s[i] == '.' && a.back() == '/' && (i + 1 == s.size() || s[i + 1] == '/')) continue;
+      a += s[i];
+    }
+    if (a.size() > 1 && a.back() == '/') a.pop_back();
+    return a;
+  }
+  static std::string CHILD(std::string const &d, std::string const &n) {
+    return d.size() == 1 ? d + n : d + "/" + n;
+  }
+
+#if defined(__linux__)
+  static constexpr uint32_t MASK = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                                   IN_DELETE_SELF | IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM |
+                                   IN_MOVED_TO | IN_ONLYDIR;
+
+  Node *watch(std::string const &d) {
+    auto it = dirs.find(d);
+    if (it != dirs.end()) return &it->second;
+    if (d.size() > 1) {
+      auto const p = d.rfind('/');
+      auto *parent = watch(p ? d.substr(0, p) : "/");
+      if (!parent) return nullptr;
+      parent->subs.emplace(d.substr(p + 1));
+    }
+    int const wd = inotify_add_watch(fd, d.c_str(), MASK);
+    if (wd < 0) return nullptr;  // missing, or out of watches
+    auto &n(dirs[d]);
+    n.wd = wd;
+    auto &ds(wds[wd]);  // the kernel keeps a watch after its Node is dropped
+    if (std::find(ds.begin(), ds.end(), d) == ds.end()) ds.emplace_back(d);
+    return &n;
+  }
+  void erase(std::string const &d) {
+    auto it = dirs.find(d);
+    if (it == dirs.end()) return;
+    for (auto const &s : it->second.subs) erase(CHILD(d, s));
+    dirs.erase(d);
+  }
+  void drain() {
+    alignas(inotify_event) char b[16384];
+    ssize_t n;
+    while ((n = read(fd, b, sizeof(b))) > 0) {
+      for (char *p = b; p < b + n;) {
+        auto const *e = reinterpret_cast<inotify_event const *>(p);
+        p += sizeof(inotify_event) + e->len;
+        if (e->mask & IN_Q_OVERFLOW) {
+          dirs.clear();
+          continue;
+        }
+        auto w = wds.find(e->wd);
+        if (w == wds.end()) continue;
+        for (auto const &d : w->second) {
+          auto it = dirs.find(d);
+          if (it == dirs.end()) continue;
+          if (e->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF | IN_UNMOUNT))
+            erase(d);
+          else if (e->len) {
+            std::string const name(e->name);
+            it->second.names.erase(name);
+            if (it->second.subs.erase(name)) erase(CHILD(d, name));
+          }
+        }
+        if (e->mask & IN_IGNORED) wds.erase(w);
+      }
+    }
+  }
+  // entry for p if it can be watched, m must be held
+  Entry *entry(std::string const &p) {
+    drain();
+    auto const a = ABS(p);
+    if (a.size() == 1) return nullptr;
+    auto const s = a.rfind('/');
+    auto *n = watch(s ? a.substr(0, s) : "/");
+    return n ? &n->names[a.substr(s + 1)] : nullptr;
+  }
+#endif
+
+ public:
+  StatCache(StatCache const &) = delete;
+  StatCache &operator=(StatCache const &) = delete;
+
+  static StatCache &INSTANCE() {
+    static StatCache i;
+    return i;
+  }
+  static bool ENABLED() { return ON().load(std::memory_order_relaxed); }
+
+  bool enable() {
+#if defined(__linux__)
+    std::lock_guard<std::mutex> l(m);
+    if (fd < 0) fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    ON() = fd >= 0;
+#endif
+    return ENABLED();
+  }
+  void disable() {
+    std::lock_guard<std::mutex> l(m);
+    ON() = 0;
+    dirs.clear();
+    wds.clear();
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+  void clear() {
+    std::lock_guard<std::mutex> l(m);
+    dirs.clear();
+  }
+
+  Stat stat(std::string const &p) {
+#if defined(__linux__)
+    std::lock_guard<std::mutex> l(m);
+    if (fd >= 0)
+      if (auto *e = entry(p)) {
+        if (e->st)
+          _hits++;
+        else {
+          _misses++;
+          e->s = STAT(p.c_str());
+          e->st = 1;
+        }
+        return e->s;
+      }
+#endif
+    return STAT(p.c_str());
+  }
+  // false if p does not resolve
+  bool real(std::string const &p, std::string &r) {
+#if defined(__linux__)
+    std::lock_guard<std::mutex> l(m);
+    if (fd >= 0)
+      if (auto *e = entry(p)) {
+        if (e->rl)
+          _hits++;
+        else {
+          _misses++;
+          if (!REAL(p.c_str(), e->real)) return 0;
+          e->rl = 1;
+        }
+        r = e->real;
+        return 1;
+      }
+#endif
+    return REAL(p.c_str(), r);
+  }
+
+  size_t hits() const { return _hits; }
+  size_t misses() const { return _misses; }
+};
+
+}  // namespace fs
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_FS_STAT_HPP_ */
@@ -0,0 +1,271 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_FS_WALK_HPP_
+#define _MKN_KUL_FS_WALK_HPP_
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mkn/kul/os.hpp"
+#include "mkn/kul/threads.hpp"
+
+namespace mkn {
+namespace kul {
+namespace fs {
+
+// shell style glob, "*" and "?" stop at "/" where "**" does not, "[a-z]" and "[!a-z]" classes
+inline bool match(std::string_view const p, std::string_view const s) {
+  size_t i = 0, j = 0;
+  while (i < p.size()) {
+    char const c = p[i];
+    if (c == '*') {
+      bool const any = i + 1 < p.size() && p[i + 1] == '*';
+      i += any ? 2 : 1;
+      if (any && i < p.size() && p[i] == '/' && match(p.substr(i + 1), s.substr(j))) return 1;
+      for (size_t k = j; k <= s.size(); k++) {
+        if (match(p.substr(i), s.substr(k))) return 1;
+        if (k < s.size() && !any && s[k] == '/') break;
+      }
+      return 0;
+    }
+    if (j == s.size()) return 0;
+    if (c == '?') {
+      if (s[j] == '/') return 0;
+    } else if (c == '[') {
+      size_t b = i + 1;
+      bool const neg = b < p.size() && (p[b] == '!' || p[b] == '^');
+      if (neg) b++;
+      bool in = 0;
+      size_t k = b;
+      for (; k < p.size() && (k == b || p[k] != ']'); k++) {
+        if (k + 2 < p.size() && p[k + 1] == '-' && p[k + 2] != ']') {
+          in |= p[k] <= s[j] && s[j] <= p[k + 2];
+          k += 2;
+        } else
+          in |= p[k] == s[j];
+      }
+      if (k == p.size()) {  // unclosed, literal
+        if (s[j] != '[') return 0;
+      } else {
+        if (in == neg) return 0;
+        i = k;
+      }
+    } else if (c != s[j])
+      return 0;
+    i++, j++;
+  }
+  return j == s.size();
+}
+
+class Entry {
+ public:
+  enum Type : uint8_t { FILE = 0, DIR, LINK, OTHER };
+
+  std::string const &path() const { return p; }
+  // relative to the directory being walked
+  std::string_view relative() const { return std::string_view(p).substr(r); }
+  std::string_view name() const { return std::string_view(p).substr(n); }
+  Type type() const { return t; }
+  bool dir() const { return t == DIR; }
+  size_t depth() const { return d; }
+
+ private:
+  template <class V>
+  friend class Walker;
+
+  std::string p;
+  size_t r = 0, n = 0, d = 0;
+  Type t = OTHER;
+};
+
+struct WalkOptions {
+  // patterns with a "/" match the relative path, otherwise the name
+  std::vector<std::string> include;  // files reported only if matching one, empty for all
+  std::vector<std::string> exclude;  // not reported, directories are not descended
+  bool hidden = false;               // names starting with "."
+  bool follow = false;               // descend symlinked directories
+  size_t threads = 0;                // 0 for one per hardware thread, 1 walks on the calling thread
+  size_t depth = std::numeric_limits<size_t>::max();
+};
+
+template <class V>
+class Walker {
+ private:
+  V &v;
+  WalkOptions const &o;
+  std::unique_ptr<WorkStealingPool<>> pool;
+  std::vector<Entry> stack;
+  std::mutex m;
+  std::set<std::pair<uint64_t, uint64_t>> seen;  // device/inode of followed directories
+
+  static bool matches(std::string const &x, Entry const &e) {
+    return match(x, x.find('/') == std::string::npos ? e.name() : e.relative());
+  }
+  bool keep(Entry const &e) const {
+    if (!o.hidden && e.name()[0] == '.') return 0;
+    for (auto const &x : o.exclude)
+      if (matches(x, e)) return 0;
+    if (e.dir() || o.include.empty()) return 1;
+    for (auto const &x : o.include)
+      if (matches(x, e)) return 1;
+    return 0;
+  }
+  bool visit(Entry const &e) {
+    if constexpr (std::is_same_v<std::invoke_result_t<V &, Entry const &>, bool>)
+      return v(e);
+    else {
+      v(e);
+      return 1;
+    }
+  }
+  bool first(uint64_t const dev, uint64_t const ino) {
+    std::lock_guard<std::mutex> l(m);
+    return seen.emplace(dev, ino).second;
+  }
+  void descend(Entry &&e) {
+    if (pool)
+      pool->async([this, e = std::move(e)]() { list(e); });
+    else
+      stack.emplace_back(std::move(e));
+  }
+  // reports then descends each entry, or stacks it for the caller when serial
+  void found(Entry const &d, std::string_view const name, Entry::Type const t) {
+    Entry e;
+    e.p.reserve(d.p.size() + 1 + name.size());
+    e.p.append(d.p);
+    if (!e.p.empty() && e.p.back() != '/' && e.p.back() != '\\') e.p += Dir::SEP();
+    e.n = e.p.size();
+    e.p.append(name);
+    e.r = d.d ? d.r : e.n;
+    e.d = d.d + 1;
+    e.t = t;
+    if (!keep(e) || !visit(e)) return;
+    if (e.dir() && e.d < o.depth) descend(std::move(e));
+  }
+
+  void list(Entry const &d) {
+#ifdef _WIN32
+    WIN32_FIND_DATA fd;
+    HANDLE h = FindFirstFile((d.p + "\\*").c_str(), &fd);
+    if (h == INVALID_HANDLE_VALUE) return;  // unreadable directories are skipped
+    do {
+      std::string_view const name(fd.cFileName);
+      if (name == "." || name == "..") continue;
+      auto const a = fd.dwFileAttributes;
+      auto const t = a & FILE_ATTRIBUTE_REPARSE_POINT && !o.follow ? Entry::LINK
+                     : a & FILE_ATTRIBUTE_DIRECTORY                ? Entry::DIR
+                                                                   : Entry::FILE;
+      found(d, name, t);
+    } while (FindNextFile(h, &fd));
+    FindClose(h);
+#else
+    int const fd = ::open(d.p.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return;  // unreadable directories are skipped
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+      ::close(fd);
+      return;
+    }
+    std::unique_ptr<DIR, int (*)(DIR *)> closer(dir, &closedir);
+    while (struct dirent *de = readdir(dir)) {
+      char const *const c = de->d_name;
+      if (c[0] == '.' && (!c[1] || (c[1] == '.' && !c[2]))) continue;
+      auto t = de->d_type == DT_REG   ? Entry::FILE
+               : de->d_type == DT_DIR ? Entry::DIR
+               : de->d_type == DT_LNK ? Entry::LINK
+                                      : Entry::OTHER;
+      bool const unknown = de->d_type == DT_UNKNOWN;
+      if (unknown || (o.follow && (t == Entry::LINK || t == Entry::DIR))) {
+        struct stat st;
+        if (fstatat(fd, c, &st, o.follow ? 0 : AT_SYMLINK_NOFOLLOW) == 0) {
+          t = S_ISREG(st.st_mode)   ? Entry::FILE
+              : S_ISDIR(st.st_mode) ? Entry::DIR
+              : S_ISLNK(st.st_mode) ? Entry::LINK
+                                    : Entry::OTHER;
+          if (o.follow && t == Entry::DIR && !first(st.st_dev, st.st_ino)) continue;
+        }
+      }
+      found(d, c, t);
+    }
+#endif
+  }
+
+ public:
+  Walker(V &_v, WalkOptions const &_o) : v(_v), o(_o) {}
+
+  void operator()(std::string const &root) {
+    Entry r;
+    r.p = root;
+    r.t = Entry::DIR;
+    size_t const n = o.threads ? o.threads : cpu::threads();
+    if (n == 1) {
+      list(r);
+      while (!stack.empty()) {
+        auto const e = std::move(stack.back());
+        stack.pop_back();
+        list(e);
+      }
+      return;
+    }
+    pool = std::make_unique<WorkStealingPool<>>(n, 1);
+    pool->async([&]() { list(r); });
+    pool->finish().join();
+    pool->rethrow();
+  }
+};
+
+// streams every entry below d to visitor(Entry const&) as it is read, a visitor returning bool
+//  can return false to not descend a directory. With more than one thread the visitor is called
+//  concurrently and entries arrive in no particular order, the first exception is rethrown
+template <class V>
+void walk(Dir const &d, V &&visitor, WalkOptions const &o = {}) {
+  if (!d.is()) KEXCEPT(fs::Exception, "Directory : \"" + d.path() + "\" does not exist");
+  Walker<std::remove_reference_t<V>>(visitor, o)(d.path());
+}
+
+}  // namespace fs
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_FS_WALK_HPP_ */
@@ -0,0 +1,422 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_FUTURE_HPP_
+#define _MKN_KUL_FUTURE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "mkn/kul/except.hpp"
+
+namespace mkn {
+namespace kul {
+
+template <class R>
+class Future;
+template <class R>
+class Promise;
+
+namespace threading {
+
+class FutureException : public mkn::kul::Exception {
+ public:
+  FutureException(char const *f, uint16_t const &l, std::string const &s)
+      : mkn::kul::Exception(f, l, s) {}
+};
+
+// unit of work handed to an Executor, release() is called once it has been run
+class Job {
+ public:
+  virtual ~Job() {}
+  virtual void run() = 0;
+  virtual void release() { delete this; }
+  virtual void cancel() { release(); }  // discarded without being run
+
+  Job *next = nullptr;
+};
+
+class Executor {
+ public:
+  virtual ~Executor() {}
+  virtual void execute(Job *job) = 0;
+  // true if the calling thread belongs to this executor and may run other jobs while waiting
+  virtual bool helps() const { return false; }
+  virtual bool help() { return false; }
+};
+
+template <class R>
+struct Storage {
+  template <class... Args>
+  void set(Args &&... args) {
+    v.emplace(std::forward<Args>(args)...);
+  }
+  R take() { return std::move(*v); }
+  std::optional<R> v;
+};
+template <>
+struct Storage<void> {
+  void set() {}
+  void take() {}
+};
+
+// shared state of a Future, also the Job which produces the result so one allocation suffices
+template <class R>
+class State : public Job {
+ private:
+  std::atomic<uint32_t> refs;
+  std::atomic<bool> r;
+  std::mutex m;
+  std::condition_variable cv;
+  Job *conts = nullptr;
+  Executor *ex = nullptr;
+
+ protected:
+  Storage<R> value;
+  std::exception_ptr ep;
+
+  void complete() {
+    Job *cs = nullptr;
+    {
+      std::lock_guard<std::mutex> l(m);
+      r = 1;
+      std::swap(cs, conts);
+    }
+    cv.notify_all();
+    while (cs) {
+      Job *n = cs->next;
+      cs->next = nullptr;
+      dispatch(cs);
+      cs = n;
+    }
+  }
+  void dispatch(Job *job) {
+    if (ex)
+      ex->execute(job);
+    else {
+      job->run();
+      job->release();
+    }
+  }
+  template <class F>
+  void apply(F &&f) {
+    try {
+      if constexpr (std::is_void_v<R>) {
+        f();
+        value.set();
+      } else
+        value.set(f());
+    } catch (...) {
+      ep = std::current_exception();
+    }
+    complete();
+  }
+
+ public:
+  State(uint32_t const &_refs, Executor *_ex) : refs(_refs), r(0), ex(_ex) {}
+  virtual ~State() {}
+
+  void ref() { refs++; }
+  void release() override {
+    if (--refs == 0) delete this;
+  }
+  void cancel() override {
+    if (!r) {
+      ep = std::make_exception_ptr(
+          FutureException(__FILE__, __LINE__, "Job discarded before completion"));
+      complete();
+    }
+    release();
+  }
+
+  bool ready() const { return r; }
+  Executor *executor() const { return ex; }
+  std::exception_ptr const &exception() const { return ep; }
+
+  void wait() {
+    while (!r) {
+      if (ex && ex->helps()) {
+        if (ex->help()) continue;
+        std::unique_lock<std::mutex> l(m);
+        cv.wait_for(l, std::chrono::microseconds(100), [&]() { return r.load(); });
+      } else {
+        std::unique_lock<std::mutex> l(m);
+        cv.wait(l, [&]() { return r.load(); });
+      }
+    }
+  }
+  R take() {
+    wait();
+    if (ep) std::rethrow_exception(ep);
+    return value.take();
+  }
+
+  // run job once this state completes, immediately if already complete
+  void chain(Job *job, bool inl = false) {
+    {
+      std::lock_guard<std::mutex> l(m);
+      if (!r) {
+        job->next = conts;
+        conts = job;
+        return;
+      }
+    }
+    if (inl) {
+      job->run();
+      job->release();
+    } else
+      dispatch(job);
+  }
+
+  template <class... Args>
+  void set(Args &&... args) {
+    value.set(std::forward<Args>(args)...);
+    complete();
+  }
+  void set(std::exception_ptr const &_ep) {
+    ep = _ep;
+    complete();
+  }
+};
+
+template <class R, class F, class... Args>
+class FutureJob : public State<R> {
+ private:
+  F f;
+  std::tuple<Args...> args;
+
+ public:
+  template <class _F, class... _Args>
+  FutureJob(Executor *ex, _F &&_f, _Args &&... _args)
+      : State<R>(2, ex), f(std::forward<_F>(_f)), args(std::forward<_Args>(_args)...) {}
+  void run() override {
+    this->apply([&]() -> R { return std::apply(f, std::move(args)); });
+  }
+};
+
+template <class R, class P, class F>
+class Continuation : public State<R> {
+ private:
+  State<P> *p;
+  F f;
+
+ public:
+  template <class _F>
+  Continuation(State<P> *_p, _F &&_f)
+      : State<R>(2, _p->executor()), p(_p), f(std::forward<_F>(_f)) {}
+  ~Continuation() {
+    if (p) p->release();
+  }
+  void run() override {
+    if (p->exception())
+      this->set(p->exception());
+    else
+      this->apply([&]() -> R {
+        if constexpr (std::is_void_v<P>)
+          return f();
+        else
+          return f(p->take());
+      });
+    p->release();
+    p = nullptr;
+  }
+};
+
+template <class R>
+class PromiseState : public State<R> {
+ public:
+  PromiseState() : State<R>(1, nullptr) {}
+  void run() override {}
+};
+
+template <class R>
+class WhenAll : public State<std::conditional_t<std::is_void_v<R>, void, std::vector<R>>> {
+  using Super = State<std::conditional_t<std::is_void_v<R>, void, std::vector<R>>>;
+
+  class Notify : public Job {
+   public:
+    Notify(WhenAll *_w) : w(_w) {}
+    void run() override {
+      if (--w->remaining == 0) w->gather();
+    }
+
+   private:
+    WhenAll *w;
+  };
+
+  std::vector<Future<R>> fs;
+  std::atomic<size_t> remaining;
+
+  void gather() {
+    std::exception_ptr const *ep = nullptr;
+    for (auto &f : fs)
+      if (!ep && f.state()->exception()) ep = &f.state()->exception();
+    if (ep)
+      this->set(*ep);
+    else if constexpr (std::is_void_v<R>)
+      this->set();
+    else {
+      std::vector<R> v;
+      v.reserve(fs.size());
+      for (auto &f : fs) v.emplace_back(f.get());
+      this->set(std::move(v));
+    }
+    this->release();  // self reference held while inputs are pending
+  }
+
+ public:
+  WhenAll(std::vector<Future<R>> &&_fs)
+      : Super(2, nullptr), fs(std::move(_fs)), remaining(fs.size() + 1) {}
+  void run() override {
+    for (auto &f : fs) f.state()->chain(new Notify(this), true);
+    if (--remaining == 0) gather();
+  }
+};
+
+}  // namespace threading
+
+template <class R>
+class Future {
+  template <class>
+  friend class Future;
+  template <class>
+  friend class threading::WhenAll;
+
+ private:
+  threading::State<R> *s = nullptr;
+
+  threading::State<R> *state() const { return s; }
+
+ public:
+  Future() {}
+  // adopts one reference of the given state
+  explicit Future(threading::State<R> *_s) : s(_s) {}
+  Future(Future const &) = delete;
+  Future(Future &&f) : s(f.s) { f.s = nullptr; }
+  ~Future() {
+    if (s) s->release();
+  }
+  Future &operator=(Future const &) = delete;
+  Future &operator=(Future &&f) {
+    if (this != &f) {
+      if (s) s->release();
+      s = f.s;
+      f.s = nullptr;
+    }
+    return *this;
+  }
+
+  bool valid() const { return s; }
+  bool ready() const {
+    if (!s) KEXCEPT(threading::FutureException, "Future has no state");
+    return s->ready();
+  }
+  void wait() const {
+    if (!s) KEXCEPT(threading::FutureException, "Future has no state");
+    s->wait();
+  }
+  // moves the result out, the future is invalid afterwards
+  R get() {
+    if (!s) KEXCEPT(threading::FutureException, "Future has no state");
+    std::unique_ptr<threading::State<R>, void (*)(threading::State<R> *)> p(
+        s, [](threading::State<R> *_s) { _s->release(); });
+    s = nullptr;
+    return p->take();
+  }
+
+  // F receives the result (nothing for void), runs on the same executor as this future's job,
+  //  exceptions skip F and propagate to the returned future. Consumes this future.
+  template <class F>
+  auto then(F &&f) {
+    if (!s) KEXCEPT(threading::FutureException, "Future has no state");
+    using N = std::conditional_t<std::is_void_v<R>, std::invoke_result<std::decay_t<F>>,
+                                 std::invoke_result<std::decay_t<F>, R>>;
+    using T = typename N::type;
+    auto *c = new threading::Continuation<T, R, std::decay_t<F>>(s, std::forward<F>(f));
+    auto *p = s;
+    s = nullptr;
+    p->chain(c);
+    return Future<T>(c);
+  }
+};
+
+template <class R>
+class Promise {
+ private:
+  threading::PromiseState<R> *s;
+
+ public:
+  Promise() : s(new threading::PromiseState<R>()) {}
+  Promise(Promise const &) = delete;
+  Promise(Promise &&p) : s(p.s) { p.s = nullptr; }
+  ~Promise() {
+    if (s) s->cancel();
+  }
+  Promise &operator=(Promise const &) = delete;
+
+  // may only be called once
+  Future<R> future() {
+    s->ref();
+    return Future<R>(s);
+  }
+  template <class... Args>
+  void set(Args &&... args) {
+    s->set(std::forward<Args>(args)...);
+    s->release();
+    s = nullptr;
+  }
+  void except(std::exception_ptr const &ep) {
+    s->set(ep);
+    s->release();
+    s = nullptr;
+  }
+};
+
+// completes when all inputs complete, with their results in order or the first exception found
+template <class R>
+auto when_all(std::vector<Future<R>> &&fs) {
+  using T = std::conditional_t<std::is_void_v<R>, void, std::vector<R>>;
+  auto *w = new threading::WhenAll<R>(std::move(fs));
+  w->run();
+  return Future<T>(w);
+}
+
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_FUTURE_HPP_ */
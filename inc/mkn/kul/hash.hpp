@@ -31,31 +31,577 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _MKN_KUL_HASH_HPP_
 #define _MKN_KUL_HASH_HPP_
 
-/*
- * REQUIRES libcrypto
- */
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
-#include <iomanip>
-#include "openssl/sha.h"
+#include "mkn/kul/io.hpp"
 
 namespace mkn {
 namespace kul {
 namespace hash {
 
+namespace detail {
+inline uint32_t le32(uint8_t const *p) {
+  return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+inline uint64_t le64(uint8_t const *p) { return le32(p) | uint64_t(le32(p + 4)) << 32; }
+inline uint32_t be32(uint8_t const *p) {
+  return uint32_t(p[3]) | uint32_t(p[2]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[0]) << 24;
+}
+inline uint32_t rotr32(uint32_t const v, int const n) { return (v >> n) | (v << (32 - n)); }
+inline uint64_t rotl64(uint64_t const v, int const n) { return (v << n) | (v >> (64 - n)); }
+}  // namespace detail
+
+enum class Algo : uint8_t { SHA256 = 0, XXH3, BLAKE3 };
+
+struct Digest {
+  std::array<uint8_t, 32> b{};
+  uint8_t n = 0;
+
+  std::string hex() const {
+    static constexpr char H[] = "0123456789abcdef";
+    std::string s(n * 2, '0');
+    for (size_t i = 0; i < n; i++) s[i * 2] = H[b[i] >> 4], s[i * 2 + 1] = H[b[i] & 15];
+    return s;
+  }
+  bool operator==(Digest const &d) const { return n == d.n && b == d.b; }
+  bool operator!=(Digest const &d) const { return !(*this == d); }
+};
+
+// FIPS 180-4
+class Sha256 {
+ private:
+  static constexpr uint32_t K[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+      0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+      0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+      0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+      0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+      0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+      0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+      0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+      0xc67178f2};
+
+  uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  uint8_t buf[64];
+  size_t bl = 0;
+  uint64_t total = 0;
+
+  void block(uint8_t const *p) {
+    using detail::rotr32;
+    uint32_t w[64];
+    for (size_t i = 0; i < 16; i++) w[i] = detail::be32(p + i * 4);
+    for (size_t i = 16; i < 64; i++) {
+      uint32_t const s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t const s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (size_t i = 0; i < 64; i++) {
+      uint32_t const t1 =
+          k + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      uint32_t const t2 =
+          (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      k = g, g = f, f = e, e = d + t1, d = c, c = b, b = a, a = t1 + t2;
+    }
+    h[0] += a, h[1] += b, h[2] += c, h[3] += d, h[4] += e, h[5] += f, h[6] += g, h[7] += k;
+  }
+
+ public:
+  Sha256 &update(void const *v, size_t n) {
+    auto const *p = static_cast<uint8_t const *>(v);
+    total += n;
+    if (bl) {
+      size_t const t = std::min(n, 64 - bl);
+      std::memcpy(buf + bl, p, t);
+      bl += t, p += t, n -= t;
+      if (bl < 64) return *this;
+      block(buf);
+      bl = 0;
+    }
+    for (; n >= 64; p += 64, n -= 64) block(p);
+    std::memcpy(buf, p, n);
+    bl = n;
+    return *this;
+  }
+  Digest digest() const {
+    Sha256 s(*this);
+    uint8_t pad[72] = {0x80};
+    size_t const padn = (bl < 56 ? 56 : 120) - bl;
+    uint64_t const bits = total * 8;
+    for (size_t i = 0; i < 8; i++) pad[padn + i] = uint8_t(bits >> (56 - i * 8));
+    s.update(pad, padn + 8);
+    Digest d;
+    d.n = 32;
+    for (size_t i = 0; i < 8; i++)
+      for (size_t j = 0; j < 4; j++) d.b[i * 4 + j] = uint8_t(s.h[i] >> (24 - j * 8));
+    return d;
+  }
+};
+
+// XXH3 64 bit with the default secret and no seed, digest bytes are big endian as XXH64_canonical
+class Xxh3 {
+ private:
+  static constexpr uint64_t P32_1 = 0x9E3779B1U, P32_2 = 0x85EBCA77U, P32_3 = 0xC2B2AE3DU;
+  static constexpr uint64_t P64_1 = 0x9E3779B185EBCA87ULL, P64_2 = 0xC2B2AE3D27D4EB4FULL,
+                            P64_3 = 0x165667B19E3779F9ULL, P64_4 = 0x85EBCA77C2B2AE63ULL,
+                            P64_5 = 0x27D4EB2F165667C5ULL, MX1 = 0x165667919E3779F9ULL,
+                            MX2 = 0x9FB21C651E98DF25ULL;
+  static constexpr size_t STRIPE = 64, SECRET = 192, STRIPES = (SECRET - STRIPE) / 8, BUF = 256;
+  static constexpr uint8_t S[SECRET] = {
+      0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad,
+      0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3,
+      0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc,
+      0xff, 0x72, 0x21, 0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+      0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65,
+      0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19,
+      0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8, 0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9,
+      0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+      0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb,
+      0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb, 0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0,
+      0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d,
+      0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+      0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e};
+
+  uint64_t acc[8] = {P32_3, P64_1, P64_2, P64_3, P64_4, P32_2, P64_5, P32_1};
+  uint8_t buf[BUF];
+  size_t bl = 0, stripes = 0;
+  uint64_t total = 0;
+
+  static uint64_t r64(uint8_t const *p) { return detail::le64(p); }
+  static uint64_t fold(uint64_t const a, uint64_t const b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t const m = __uint128_t(a) * b;
+    return uint64_t(m) ^ uint64_t(m >> 64);
+#else
+    uint64_t const lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF), m1 = (a >> 32) * (b & 0xFFFFFFFF),
+                   m2 = (a & 0xFFFFFFFF) * (b >> 32), hi = (a >> 32) * (b >> 32);
+    uint64_t const cross = (lo >> 32) + (m1 & 0xFFFFFFFF) + m2;
+    return ((cross << 32) | (lo & 0xFFFFFFFF)) ^ (hi + (m1 >> 32) + (cross >> 32));
+#endif
+  }
+  static uint64_t avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= MX1;
+    return h ^ (h >> 32);
+  }
+  static uint64_t avalanche64(uint64_t h) {
+    h ^= h >> 33;
+    h *= P64_2;
+    h ^= h >> 29;
+    h *= P64_3;
+    return h ^ (h >> 32);
+  }
+  static uint64_t mix16(uint8_t const *p, uint8_t const *s) {
+    return fold(r64(p) ^ r64(s), r64(p + 8) ^ r64(s + 8));
+  }
+  static void stripe(uint64_t *a, uint8_t const *p, uint8_t const *s) {
+    for (size_t i = 0; i < 8; i++) {
+      uint64_t const v = r64(p + i * 8), k = v ^ r64(s + i * 8);
+      a[i ^ 1] += v;
+      a[i] += (k & 0xFFFFFFFF) * (k >> 32);
+    }
+  }
+  static void scramble(uint64_t *a) {
+    for (size_t i = 0; i < 8; i++) {
+      uint64_t v = a[i];
+      v ^= v >> 47;
+      v ^= r64(S + SECRET - STRIPE + i * 8);
+      a[i] = v * P32_1;
+    }
+  }
+  static void consume(uint64_t *a, size_t &sofar, uint8_t const *p, size_t n) {
+    for (; n; n--, p += STRIPE) {
+      stripe(a, p, S + sofar * 8);
+      if (++sofar == STRIPES) scramble(a), sofar = 0;
+    }
+  }
+  static uint64_t merge(uint64_t const *a, uint64_t const len) {
+    uint64_t r = len * P64_1;
+    for (size_t i = 0; i < 4; i++)
+      r += fold(a[i * 2] ^ r64(S + 11 + i * 16), a[i * 2 + 1] ^ r64(S + 11 + i * 16 + 8));
+    return avalanche(r);
+  }
+
+ public:
+  static uint64_t SHORT(uint8_t const *p, size_t const n) {
+    if (n == 0) return avalanche64(r64(S + 56) ^ r64(S + 64));
+    if (n <= 3) {
+      uint32_t const c =
+          uint32_t(p[0]) << 16 | uint32_t(p[n >> 1]) << 24 | p[n - 1] | uint32_t(n) << 8;
+      return avalanche64(c ^ uint64_t(detail::le32(S) ^ detail::le32(S + 4)));
+    }
+    if (n <= 8) {
+      uint64_t const in = detail::le32(p + n - 4) + (uint64_t(detail::le32(p)) << 32);
+      uint64_t h = in ^ (r64(S + 8) ^ r64(S + 16));
+      h ^= detail::rotl64(h, 49) ^ detail::rotl64(h, 24);
+      h *= MX2;
+      h ^= (h >> 35) + n;
+      h *= MX2;
+      return h ^ (h >> 28);
+    }
+    if (n <= 16) {
+      uint64_t const lo = r64(p) ^ (r64(S + 24) ^ r64(S + 32)),
+                     hi = r64(p + n - 8) ^ (r64(S + 40) ^ r64(S + 48));
+      return avalanche(n + __builtin_bswap64(lo) + hi + fold(lo, hi));
+    }
+    uint64_t a = n * P64_1;
+    if (n <= 128) {
+      if (n > 32) {
+        if (n > 64) {
+          if (n > 96) a += mix16(p + 48, S + 96) + mix16(p + n - 64, S + 112);
+          a += mix16(p + 32, S + 64) + mix16(p + n - 48, S + 80);
+        }
+        a += mix16(p + 16, S + 32) + mix16(p + n - 32, S + 48);
+      }
+      return avalanche(a + mix16(p, S) + mix16(p + n - 16, S + 16));
+    }
+    for (size_t i = 0; i < 8; i++) a += mix16(p + i * 16, S + i * 16);
+    a = avalanche(a);
+    for (size_t i = 8; i < n / 16; i++) a += mix16(p + i * 16, S + (i - 8) * 16 + 3);
+    return avalanche(a + mix16(p + n - 16, S + 136 - 17));
+  }
+
+  Xxh3 &update(void const *v, size_t n) {
+    auto const *p = static_cast<uint8_t const *>(v);
+    total += n;
+    if (n <= BUF - bl) {
+      std::memcpy(buf + bl, p, n);
+      bl += n;
+      return *this;
+    }
+    // stripes are only consumed with more input behind them, the last is kept for digest
+    if (bl) {
+      size_t const t = BUF - bl;
+      std::memcpy(buf + bl, p, t);
+      p += t, n -= t;
+      consume(acc, stripes, buf, BUF / STRIPE);
+      bl = 0;
+    }
+    if (n > BUF) {
+      do {
+        consume(acc, stripes, p, BUF / STRIPE);
+        p += BUF, n -= BUF;
+      } while (n > BUF);
+      std::memcpy(buf + BUF - STRIPE, p - STRIPE, STRIPE);
+    }
+    std::memcpy(buf, p, n);
+    bl = n;
+    return *this;
+  }
+  uint64_t value() const {
+    if (total <= 240) return SHORT(buf, total);
+    uint64_t a[8];
+    std::memcpy(a, acc, sizeof(a));
+    uint8_t last[STRIPE];
+    uint8_t const *l = last;
+    if (bl >= STRIPE) {
+      size_t s = stripes;
+      consume(a, s, buf, (bl - 1) / STRIPE);
+      l = buf + bl - STRIPE;
+    } else {
+      std::memcpy(last, buf + BUF - (STRIPE - bl), STRIPE - bl);
+      std::memcpy(last + STRIPE - bl, buf, bl);
+    }
+    stripe(a, l, S + SECRET - STRIPE - 7);
+    return merge(a, total);
+  }
+  Digest digest() const {
+    Digest d;
+    d.n = 8;
+    uint64_t const v = value();
+    for (size_t i = 0; i < 8; i++) d.b[i] = uint8_t(v >> (56 - i * 8));
+    return d;
+  }
+};
+
+// BLAKE3 unkeyed with 32 byte output
+class Blake3 {
+ private:
+  static constexpr uint32_t IV[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                                     0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+  static constexpr uint8_t PERM[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+  static constexpr uint32_t START = 1, END = 2, PARENT = 4, ROOT = 8;
+  static constexpr size_t CHUNK = 1024, BLOCK = 64;
+
+  static void g(uint32_t *s, int a, int b, int c, int d, uint32_t x, uint32_t y) {
+    using detail::rotr32;
+    s[a] = s[a] + s[b] + x, s[d] = rotr32(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d], s[b] = rotr32(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + y, s[d] = rotr32(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d], s[b] = rotr32(s[b] ^ s[c], 7);
+  }
+  // first 8 words of the output, all that is needed below the root
+  static void compress(uint32_t const *cv, uint32_t const *block, uint64_t const counter,
+                       uint32_t const len, uint32_t const flags, uint32_t *out) {
+    uint32_t s[16] = {cv[0],  cv[1],  cv[2],  cv[3],         cv[4],
+                      cv[5],  cv[6],  cv[7],  IV[0],         IV[1],
+                      IV[2],  IV[3],  uint32_t(counter), uint32_t(counter >> 32), len,
+                      flags};
+    uint32_t m[16], t[16];
+    std::memcpy(m, block, sizeof(m));
+    for (size_t r = 0; r < 7; r++) {
+      g(s, 0, 4, 8, 12, m[0], m[1]), g(s, 1, 5, 9, 13, m[2], m[3]);
+      g(s, 2, 6, 10, 14, m[4], m[5]), g(s, 3, 7, 11, 15, m[6], m[7]);
+      g(s, 0, 5, 10, 15, m[8], m[9]), g(s, 1, 6, 11, 12, m[10], m[11]);
+      g(s, 2, 7, 8, 13, m[12], m[13]), g(s, 3, 4, 9, 14, m[14], m[15]);
+      for (size_t i = 0; i < 16; i++) t[i] = m[PERM[i]];
+      std::memcpy(m, t, sizeof(m));
+    }
+    for (size_t i = 0; i < 8; i++) out[i] = s[i] ^ s[i + 8];
+  }
+  static void words(uint8_t const *p, uint32_t *w) {
+    for (size_t i = 0; i < 16; i++) w[i] = detail::le32(p + i * 4);
+  }
+
+  struct Output {
+    uint32_t cv[8], block[16];
+    uint64_t counter;
+    uint32_t len, flags;
+  };
+
+  uint32_t cv[8];
+  uint32_t stack[54][8];
+  size_t depth = 0;
+  uint64_t chunk = 0;
+  uint8_t buf[BLOCK];
+  size_t bl = 0, blocks = 0;  // within the current chunk
+
+  Output output() const {
+    Output o;
+    std::memcpy(o.cv, cv, sizeof(cv));
+    uint8_t b[BLOCK] = {};
+    std::memcpy(b, buf, bl);
+    words(b, o.block);
+    o.counter = chunk;
+    o.len = uint32_t(bl);
+    o.flags = (blocks ? 0 : START) | END;
+    return o;
+  }
+  static Output parent(uint32_t const *l, uint32_t const *r) {
+    Output o;
+    std::memcpy(o.cv, IV, sizeof(IV));
+    std::memcpy(o.block, l, 32);
+    std::memcpy(o.block + 8, r, 32);
+    o.counter = 0;
+    o.len = BLOCK;
+    o.flags = PARENT;
+    return o;
+  }
+  static void chain(Output const &o, uint32_t *out) {
+    compress(o.cv, o.block, o.counter, o.len, o.flags, out);
+  }
+  void push(uint32_t *c, uint64_t total) {
+    for (; (total & 1) == 0; total >>= 1) {
+      uint32_t p[8];
+      chain(parent(stack[--depth], c), p);
+      std::memcpy(c, p, 32);
+    }
+    std::memcpy(stack[depth++], c, 32);
+  }
+
+ public:
+  Blake3() { std::memcpy(cv, IV, sizeof(cv)); }
+
+  Blake3 &update(void const *v, size_t n) {
+    auto const *p = static_cast<uint8_t const *>(v);
+    while (n) {
+      if (blocks * BLOCK + bl == CHUNK) {  // only closed with more input behind it
+        uint32_t c[8];
+        chain(output(), c);
+        push(c, ++chunk);
+        std::memcpy(cv, IV, sizeof(cv));
+        bl = blocks = 0;
+      }
+      if (bl == BLOCK) {
+        uint32_t w[16];
+        words(buf, w);
+        compress(cv, w, chunk, BLOCK, blocks ? 0 : START, cv);
+        blocks++;
+        bl = 0;
+      }
+      size_t const t = std::min(n, std::min(BLOCK - bl, CHUNK - blocks * BLOCK - bl));
+      std::memcpy(buf + bl, p, t);
+      bl += t, p += t, n -= t;
+    }
+    return *this;
+  }
+  Digest digest() const {
+    Output o = output();
+    for (size_t i = depth; i-- > 0;) {
+      uint32_t c[8];
+      chain(o, c);
+      o = parent(stack[i], c);
+    }
+    uint32_t s[16] = {o.cv[0], o.cv[1], o.cv[2], o.cv[3], o.cv[4], o.cv[5], o.cv[6], o.cv[7]};
+    uint32_t out[8];
+    compress(s, o.block, 0, o.len, o.flags | ROOT, out);
+    Digest d;
+    d.n = 32;
+    for (size_t i = 0; i < 8; i++)
+      for (size_t j = 0; j < 4; j++) d.b[i * 4 + j] = uint8_t(out[i] >> (j * 8));
+    return d;
+  }
+};
+
+inline Digest digest(void const *p, size_t const n, Algo const a) {
+  switch (a) {
+    case Algo::SHA256:
+      return Sha256().update(p, n).digest();
+    case Algo::BLAKE3:
+      return Blake3().update(p, n).digest();
+    default:
+      return Xxh3().update(p, n).digest();
+  }
+}
+inline Digest digest(std::string_view const s, Algo const a) {
+  return digest(s.data(), s.size(), a);
+}
+
+// whole file through a read only mapping
+inline Digest file(File const &f, Algo const a = Algo::XXH3) {
+  io::MappedReader m(f);
+  return digest(m.data(), a);
+}
+
+// digests of files on disk, an entry is reused while the file's (device, inode, size, mtime)
+//  are unchanged so unchanged files are not read. Saved on destruction if anything changed
+class Cache {
+ private:
+  struct Key {
+    uint64_t dev, ino;
+    Algo a;
+    bool operator==(Key const &k) const { return dev == k.dev && ino == k.ino && a == k.a; }
+  };
+  struct KeyHash {
+    size_t operator()(Key const &k) const {
+      return std::hash<uint64_t>()(k.ino * 0x9E3779B97F4A7C15ULL ^ k.dev) ^ size_t(k.a);
+    }
+  };
+  struct Value {
+    uint64_t size, mtime;
+    Digest d;
+  };
+
+  std::string const p;
+  std::mutex m;
+  std::unordered_map<Key, Value, KeyHash> es;
+  bool dirty = 0;
+  size_t _hits = 0, _misses = 0;
+
+  // mtime in nanoseconds where the platform has it
+  static bool STAT(std::string const &f, Key &k, Value &v) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(f.c_str(), &st) != 0) return 0;
+    v.mtime = uint64_t(st.st_mtime) * 1000000000;
+#else
+    struct stat st;
+    if (::stat(f.c_str(), &st) != 0) return 0;
+#if defined(__APPLE__)
+    v.mtime = uint64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    v.mtime = uint64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+    k.dev = st.st_dev, k.ino = st.st_ino, v.size = st.st_size;
+    return 1;
+  }
+
+  // "algo dev ino size mtime hex" per line, damaged lines are dropped
+  void load() {
+    if (!File(p).is()) return;
+    io::MappedReader r(p.c_str());
+    std::string_view l;
+    while (r.readLine(l)) {
+      uint64_t f[5];
+      char const *c = l.data(), *const e = l.data() + l.size();
+      size_t i = 0;
+      for (; i < 5 && c < e; i++, c++) {
+        auto const res = std::from_chars(c, e, f[i]);
+        if (res.ec != std::errc() || res.ptr == e || *res.ptr != ' ') break;
+        c = res.ptr;
+      }
+      size_t const n = e - c;
+      if (i < 5 || f[0] > 2 || n % 2 || n > 64) continue;
+      Value v{f[3], f[4], {}};
+      v.d.n = uint8_t(n / 2);
+      for (i = 0; i < v.d.n; i++)
+        if (std::from_chars(c + i * 2, c + i * 2 + 2, v.d.b[i], 16).ec != std::errc()) break;
+      if (i == v.d.n) es[Key{f[1], f[2], Algo(f[0])}] = v;
+    }
+  }
+
+ public:
+  Cache(File const &f) : p(f.full()) { load(); }
+  Cache(Cache const &) = delete;
+  Cache &operator=(Cache const &) = delete;
+  ~Cache() {
+    try {
+      save();
+    } catch (mkn::kul::Exception const &e) {
+      KERR << e.what();
+    }
+  }
+
+  Digest file(File const &f, Algo const a = Algo::XXH3) {
+    Key k{0, 0, a};
+    Value v{0, 0, {}};
+    if (!STAT(f.full(), k, v)) KEXCEPT(io::Exception, "Cannot stat file: " + f.full());
+    {
+      std::lock_guard<std::mutex> l(m);
+      auto it = es.find(k);
+      if (it != es.end() && it->second.size == v.size && it->second.mtime == v.mtime) {
+        _hits++;
+        return it->second.d;
+      }
+      _misses++;
+    }
+    v.d = hash::file(f, a);  // stat first, a change while reading is seen next time
+    std::lock_guard<std::mutex> l(m);
+    es[k] = v;
+    dirty = 1;
+    return v.d;
+  }
+
+  void save() {
+    std::lock_guard<std::mutex> l(m);
+    if (!dirty) return;
+    {
+      io::BufferedWriter w(p + ".tmp");
+      for (auto const &e : es)
+        w << std::to_string(unsigned(e.first.a)) << ' ' << e.first.dev << ' ' << e.first.ino
+          << ' ' << e.second.size << ' ' << e.second.mtime << ' ' << e.second.d.hex() << '\n';
+    }
+    if (std::rename((p + ".tmp").c_str(), p.c_str()) != 0)
+      KEXCEPT(io::Exception, "Cannot write hash cache: " + p);
+    dirty = 0;
+  }
+  void clear() {
+    std::lock_guard<std::mutex> l(m);
+    dirty = dirty || !es.empty();
+    es.clear();
+  }
+  size_t hits() const { return _hits; }
+  size_t misses() const { return _misses; }
+};
+
+// kept for compatibility, no longer needs libcrypto
 class SHA {
  public:
   static void _256(std::string const &str, std::string &ret) {
-    unsigned char h[SHA256_DIGEST_LENGTH];
-    SHA256_CTX sha;
-    SHA256_Init(&sha);
-    SHA256_Update(&sha, str.c_str(), str.size());
-    SHA256_Final(h, &sha);
-    std::stringstream ss;
-    for (size_t i = 0; i < SHA256_DIGEST_LENGTH; i++)
-      ss << std::hex << std::setw(2) << std::setfill('0') << (int16_t)h[i];
-    ret = ss.str();
+    ret = Sha256().update(str.data(), str.size()).digest().hex();
   }
 };
+
 }  // namespace hash
 }  // namespace kul
 }  // namespace mkn
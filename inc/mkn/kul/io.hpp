@@ -32,14 +32,39 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _MKN_KUL_IO_HPP_
 
 #include <time.h>
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
 #include <cstring>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <intrin.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 #include "mkn/kul/except.hpp"
 #include "mkn/kul/log.hpp"
 #include "mkn/kul/os.hpp"
+#include "mkn/kul/span.hpp"
 #include "mkn/kul/string.hpp"
 
 namespace mkn {
@@ -51,6 +76,44 @@ class Exception : public mkn::kul::Exception {
   Exception(char const *f, const size_t &l, std::string const &s) : mkn::kul::Exception(f, l, s) {}
 };
 
+namespace detail {
+inline uint32_t ctz(uint32_t const m) {
+#ifdef _MSC_VER
+  unsigned long i;
+  _BitScanForward(&i, m);
+  return i;
+#else
+  return __builtin_ctz(m);
+#endif
+}
+// first '\n' or '\r' in [p, e), or e, checking 32 bytes at a time where SSE2/AVX2 is available
+inline char const *eol(char const *p, char const *const e) {
+#if defined(__AVX2__)
+  __m256i const n = _mm256_set1_epi8('\n'), r = _mm256_set1_epi8('\r');
+  for (; e - p >= 32; p += 32) {
+    __m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p));
+    uint32_t const m = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, n), _mm256_cmpeq_epi8(v, r)));
+    if (m) return p + ctz(m);
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  __m128i const n = _mm_set1_epi8('\n'), r = _mm_set1_epi8('\r');
+  for (; e - p >= 32; p += 32) {
+    __m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+    __m128i const b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + 16));
+    uint32_t const m =
+        uint32_t(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(a, n), _mm_cmpeq_epi8(a, r)))) |
+        uint32_t(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(b, n), _mm_cmpeq_epi8(b, r))))
+            << 16;
+    if (m) return p + ctz(m);
+  }
+#endif
+  for (; p < e; ++p)
+    if (*p == '\n' || *p == '\r') return p;
+  return e;
+}
+}  // namespace detail
+
 class AReader {
  public:
   std::ifstream const &buffer() const { return f; }
@@ -66,48 +129,52 @@ class AReader {
   static void seek(std::ifstream &_f, const size_t &_l) { _f.seekg(_l); }
 
  protected:
+  // lines are scanned from a block read ahead of the stream, see unread
   char const *readLine(std::ifstream &_f) {
     s1.clear();
-    if (_f.good()) {
-      std::stringstream ss;
-      std::istream::sentry sen(_f, true);
-      std::streambuf *sb = _f.rdbuf();
-      for (;;) {
-        int c = sb->sbumpc();
-        switch (c) {
-          case '\n':
-            return (s1 = ss.str()).c_str();
-          case '\r':
-            if (sb->sgetc() == '\n') sb->sbumpc();
-            return (s1 = ss.str()).c_str();
-          case EOF:
-            s1 = ss.str();
-            if (s1.empty()) _f.setstate(std::ios::eofbit);
-            return s1.empty() ? 0 : s1.c_str();
-          default:
-            ss << (char)c;
-        }
+    if (!_f.good()) return 0;
+    if (!b) b = std::make_unique<char[]>(BLOCK);
+    for (;;) {
+      if (bp == be && !fill(_f)) {
+        if (s1.empty()) _f.setstate(std::ios::eofbit);
+        return s1.empty() ? 0 : s1.c_str();
       }
+      char const *const p = b.get() + bp, *const e = b.get() + be, *n = detail::eol(p, e);
+      s1.append(p, n);
+      bp = n - b.get();
+      if (n == e) continue;
+      if (b[bp++] == '\r' && (bp < be || fill(_f)) && b[bp] == '\n') bp++;
+      return s1.c_str();
     }
-    return 0;
   }
+  // gives read ahead bytes back to the stream before it is used directly
+  void unread(std::ifstream &_f) {
+    if (bp == be) return;
+    _f.clear(_f.rdstate() & ~std::ios::eofbit);
+    _f.seekg(-std::streamoff(be - bp), std::ios::cur);
+    bp = be = 0;
+  }
+  void discard() { bp = be = 0; }
+  // straight into c, which is not null terminated
   size_t read(char *c, std::ifstream &_f, const size_t &l) {
-    s1.clear();
-    if (_f.good()) {
-      std::vector<char> v;
-      v.resize(l);
-      _f.read(&v[0], l);
-      v.resize((size_t)_f.gcount());
-      s1 = std::string(v.begin(), v.end());
-      std::strcpy(c, s1.c_str());
-      return s1.size();
-    }
-    return 0;
+    unread(_f);
+    if (!_f.good()) return 0;
+    return std::max<std::streamsize>(_f.rdbuf()->sgetn(c, l), 0);
   }
   std::ifstream f;
 
  private:
+  static constexpr size_t BLOCK = 1 << 16;
+
+  bool fill(std::ifstream &_f) {
+    bp = 0;
+    be = std::max<std::streamsize>(_f.rdbuf()->sgetn(b.get(), BLOCK), 0);
+    return be;
+  }
+
   std::string s1;
+  std::unique_ptr<char[]> b;
+  size_t bp = 0, be = 0;
 };
 class Reader : public AReader {
  public:
@@ -116,41 +183,224 @@ class Reader : public AReader {
   ~Reader() { f.close(); }
   char const *readLine() { return AReader::readLine(f); }
   size_t read(char *c, const size_t &s) { return AReader::read(c, f, s); }
-  void seek(const size_t &l) { AReader::seek(f, l); }
+  void seek(const size_t &l) {
+    discard();
+    AReader::seek(f, l);
+  }
 };
 class BinaryReader : public AReader {
  private:
+#ifndef _WIN32
+  int fd = -1;
+  int64_t o = -1;  // pread offset, while < 0 the stream has the position
+
+  // the stream is used for lines
+  void sync() {
+    if (o < 0) return;
+    f.clear();
+    f.seekg(o);
+    o = -1;
+  }
+#endif
+
  public:
   BinaryReader(char const *c) : AReader(c, std::ios::in | std::ios::binary) {
     f.exceptions(std::ifstream::badbit | std::ifstream::failbit);
+#ifndef _WIN32
+    fd = ::open(c, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) KEXCEPT(Exception, "FileException : file \"" + std::string(c) + "\" not found");
+#endif
   }
   BinaryReader(File const &c) : BinaryReader(c.full().c_str()) {}
-  ~BinaryReader() { f.close(); }
-  char const *readLine() { return AReader::readLine(f); }
+  ~BinaryReader() {
+#ifndef _WIN32
+    if (fd >= 0) ::close(fd);
+#endif
+    f.close();
+  }
+  char const *readLine() {
+#ifndef _WIN32
+    sync();
+#endif
+    return AReader::readLine(f);
+  }
 #ifdef _WIN32
   size_t read(char *c, const size_t &s) { return AReader::read(c, f, s); }
 #else
+  // reads until s bytes or the end of the file
   size_t read(char *c, const size_t &s) {
+    if (o < 0) {
+      unread(f);
+      f.clear();
+      o = f.tellg();
+    }
     size_t red = 0;
-    try {
-      red = f.readsome(c, s);
-      KLOG(INF) << red;
-    } catch (const std::ios_base::failure &e) {
-      KLOG(ERR) << e.what();
+    while (red < s) {
+      auto const r = ::pread(fd, c + red, s - red, o + red);
+      if (r < 0 && errno == EINTR) continue;
+      if (r < 0) KEXCEPT(Exception, "FileException : read failed: " + std::string(strerror(errno)));
+      if (r == 0) break;
+      red += r;
     }
+    o += red;
     return red;
   }
-  size_t read(uint8_t *c, const size_t &s) {
-    size_t red = 0;
-    try {
-      red = f.readsome((char *)c, s);
-    } catch (const std::ios_base::failure &e) {
-      KLOG(ERR) << e.what();
+#endif
+  size_t read(uint8_t *c, const size_t &s) { return read(reinterpret_cast<char *>(c), s); }
+  size_t read_into(Span<uint8_t> s) { return read(s.data(), s.size()); }
+  void seek(const size_t &s) {
+    discard();
+#ifdef _WIN32
+    AReader::seek(f, s);
+#else
+    o = s;
+#endif
+  }
+};
+
+// the whole file in one read, sized up front
+inline std::vector<uint8_t> readAll(File const &file) {
+  std::vector<uint8_t> v;
+#ifdef _WIN32
+  std::ifstream f(file.full(), std::ios::in | std::ios::binary);
+  if (!f) KEXCEPT(Exception, "FileException : file \"" + file.full() + "\" not found");
+  v.resize(file.size());
+  v.resize(std::max<std::streamsize>(f.rdbuf()->sgetn((char *)v.data(), v.size()), 0));
+#else
+  int const fd = ::open(file.full().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) KEXCEPT(Exception, "FileException : file \"" + file.full() + "\" not found");
+  struct stat st;
+  v.resize(fstat(fd, &st) == 0 ? st.st_size : file.size());
+  size_t red = 0;
+  int e = 0;
+  while (red < v.size()) {
+    auto const r = ::pread(fd, v.data() + red, v.size() - red, red);
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0) e = errno;
+    if (r <= 0) break;
+    red += r;
+  }
+  ::close(fd);
+  if (e) KEXCEPT(Exception, "FileException : read failed: " + std::string(strerror(e)));
+  v.resize(red);
+#endif
+  return v;
+}
+
+// read only mapping of a whole file, lines and chunks are views into the mapping
+//  lines end as with AReader::readLine, at "\n", "\r" or "\r\n"
+class MappedReader {
+ private:
+  char const *d = nullptr;
+  size_t s = 0, p = 0;
+#ifdef _WIN32
+  HANDLE h = INVALID_HANDLE_VALUE, m = nullptr;
+#endif
+
+  void map(char const *const path, bool const sequential) {
+#ifdef _WIN32
+    h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                    sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE)
+      KEXCEPT(Exception, "FileException : file \"" + std::string(path) + "\" not found");
+    LARGE_INTEGER li;
+    if (!GetFileSizeEx(h, &li)) KEXCEPT(Exception, "Cannot size file: " + std::string(path));
+    s = li.QuadPart;
+    if (!s) return;
+    m = CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m) d = static_cast<char const *>(MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0));
+    if (!d) KEXCEPT(Exception, "Cannot map file: " + std::string(path));
+#else
+    int const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) KEXCEPT(Exception, "FileException : file \"" + std::string(path) + "\" not found");
+    struct stat st;
+    if (fstat(fd, &st) == 0) s = st.st_size;
+    if (s) {
+      void *v = mmap(nullptr, s, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (v != MAP_FAILED) d = static_cast<char const *>(v);
     }
-    return red;
+    ::close(fd);
+    if (s && !d) KEXCEPT(Exception, "Cannot map file: " + std::string(path));
+    if (d && sequential) {
+      madvise(const_cast<char *>(d), s, MADV_SEQUENTIAL);
+      madvise(const_cast<char *>(d), s, MADV_WILLNEED);
+    }
+#endif
   }
+
+ public:
+  MappedReader(char const *const path, bool const sequential = 1) { map(path, sequential); }
+  MappedReader(File const &f, bool const sequential = 1)
+      : MappedReader(f.full().c_str(), sequential) {}
+  MappedReader(MappedReader const &) = delete;
+  MappedReader &operator=(MappedReader const &) = delete;
+  ~MappedReader() {
+#ifdef _WIN32
+    if (d) UnmapViewOfFile(d);
+    if (m) CloseHandle(m);
+    if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+#else
+    if (d) munmap(const_cast<char *>(d), s);
 #endif
-  void seek(const size_t &s) { AReader::seek(f, s); }
+  }
+
+  std::string_view data() const { return std::string_view(d, s); }
+  size_t size() const { return s; }
+  size_t tell() const { return p; }
+  void seek(size_t const &l) { p = l < s ? l : s; }
+
+  // false once all lines have been read
+  bool readLine(std::string_view &l) {
+    if (p == s) return false;
+    char const *const b = d + p, *const e = d + s;
+    char const *n = detail::eol(b, e);
+    l = std::string_view(b, n - b);
+    if (n < e && *n++ == '\r' && n < e && *n == '\n') ++n;
+    p = n - d;
+    return true;
+  }
+  // up to n bytes, false once all have been read
+  bool readChunk(std::string_view &c, size_t const &n) {
+    if (p == s) return false;
+    c = std::string_view(d + p, n < s - p ? n : s - p);
+    p += c.size();
+    return true;
+  }
+
+  template <class F>
+  class Range {
+   private:
+    MappedReader &r;
+    F f;
+
+   public:
+    class iterator {
+     private:
+      Range *rg;
+      std::string_view v;
+
+     public:
+      iterator(Range *_rg) : rg(_rg) { ++*this; }
+      std::string_view const &operator*() const { return v; }
+      iterator &operator++() {
+        if (rg && !rg->f(rg->r, v)) rg = nullptr;
+        return *this;
+      }
+      bool operator!=(iterator const &o) const { return rg != o.rg; }
+    };
+    Range(MappedReader &_r, F &&_f) : r(_r), f(std::move(_f)) {}
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(nullptr); }
+  };
+  // for (auto const &line : reader.lines()), from the current position
+  auto lines() {
+    auto f = [](MappedReader &r, std::string_view &v) { return r.readLine(v); };
+    return Range<decltype(f)>(*this, std::move(f));
+  }
+  auto chunks(size_t const n) {
+    auto f = [n](MappedReader &r, std::string_view &v) { return r.readChunk(v, n); };
+    return Range<decltype(f)>(*this, std::move(f));
+  }
 };
 
 class AWriter {
@@ -161,10 +411,9 @@ class AWriter {
   void close() { f.close(); }
 
   AWriter &write(char const *c, bool nl = false) {
-    if (nl)
-      f << c << mkn::kul::os::EOL();
-    else
-      f << c;
+    static std::string const eol(mkn::kul::os::EOL());
+    f << c;
+    if (nl) f << eol;
     return *this;
   }
   AWriter &write(char const *c, size_t len) {
@@ -218,6 +467,212 @@ class BinaryWriter : public AWriter {
     f.close();
   }
 };
+
+// writes through a large buffer in whole BLOCKs, optionally on a background thread which
+//  writes one full buffer while the caller fills the other
+class BufferedWriter {
+ public:
+  static constexpr size_t BLOCK = 4096;
+
+ private:
+  size_t const cap;  // a multiple of BLOCK
+  std::unique_ptr<char[]> a, b;
+  size_t n = 0;
+#ifdef _WIN32
+  HANDLE h = INVALID_HANDLE_VALUE;
+#else
+  int fd = -1;
+#endif
+  std::string const eol;
+  std::thread t;
+  std::mutex m;
+  std::condition_variable cv;
+  char const *pending = nullptr;
+  size_t pn = 0;
+  bool stop = 0;
+  std::string error;
+
+  void raw(char const *c, size_t l) {
+    while (l) {
+#ifdef _WIN32
+      DWORD w = 0;
+      if (!WriteFile(h, c, DWORD(std::min<size_t>(l, 1u << 30)), &w, nullptr))
+        KEXCEPT(Exception, "BufferedWriter write failed: " + std::to_string(GetLastError()));
+#else
+      auto const w = ::write(fd, c, l);
+      if (w < 0) {
+        if (errno == EINTR) continue;
+        KEXCEPT(Exception, "BufferedWriter write failed: " + std::string(strerror(errno)));
+      }
+#endif
+      c += w;
+      l -= w;
+    }
+  }
+  // the buffer then c, in one call where writev exists
+  void raw(char const *c, size_t const l, char const *d, size_t const k) {
+#ifdef _WIN32
+    raw(c, l);
+    raw(d, k);
+#else
+    iovec v[2]{{const_cast<char *>(c), l}, {const_cast<char *>(d), k}};
+    iovec *p = v;
+    size_t left = 2;
+    while (left) {
+      auto w = ::writev(fd, p, left);
+      if (w < 0) {
+        if (errno == EINTR) continue;
+        KEXCEPT(Exception, "BufferedWriter write failed: " + std::string(strerror(errno)));
+      }
+      for (; left && size_t(w) >= p->iov_len; left--, p++) w -= p->iov_len;
+      if (left) {
+        p->iov_base = static_cast<char *>(p->iov_base) + w;
+        p->iov_len -= w;
+      }
+    }
+#endif
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> l(m);
+    for (;;) {
+      cv.wait(l, [&]() { return pending || stop; });
+      if (!pending) return;
+      l.unlock();
+      try {
+        raw(pending, pn);
+      } catch (const mkn::kul::Exception &e) {
+        l.lock();
+        error = e.what();
+        l.unlock();
+      }
+      l.lock();
+      pending = nullptr;
+      cv.notify_all();
+    }
+  }
+  void wait() {
+    if (!t.joinable()) return;
+    std::unique_lock<std::mutex> l(m);
+    cv.wait(l, [&]() { return !pending; });
+    if (error.size()) {
+      std::string e;
+      e.swap(error);
+      KEXCEPT(Exception, e);
+    }
+  }
+  // hands the whole of a to the writer thread, or writes it
+  void drain() {
+    if (t.joinable()) {
+      wait();
+      std::lock_guard<std::mutex> l(m);
+      a.swap(b);
+      pending = b.get();
+      pn = n;
+      cv.notify_all();
+    } else
+      raw(a.get(), n);
+    n = 0;
+  }
+
+ public:
+  // buffer is rounded up to a multiple of BLOCK
+  BufferedWriter(char const *path, size_t const buffer = 1 << 20, bool const async = 0,
+                 bool const append = 0)
+      : cap(std::max<size_t>((buffer + BLOCK - 1) / BLOCK, 1) * BLOCK),
+        a(std::make_unique<char[]>(cap)),
+        eol(mkn::kul::os::EOL()) {
+#ifdef _WIN32
+    h = CreateFileA(path, append ? FILE_APPEND_DATA : GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                    append ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE)
+#else
+    fd = ::open(path, O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+    if (fd < 0)
+#endif
+      KEXCEPT(Exception, "FileException : file \"" + std::string(path) + "\" not found");
+    if (async) {
+      b = std::make_unique<char[]>(cap);
+      t = std::thread(&BufferedWriter::run, this);
+    }
+  }
+  BufferedWriter(File const &f, size_t const buffer = 1 << 20, bool const async = 0,
+                 bool const append = 0)
+      : BufferedWriter(f.full().c_str(), buffer, async, append) {}
+  BufferedWriter(BufferedWriter const &) = delete;
+  BufferedWriter &operator=(BufferedWriter const &) = delete;
+  ~BufferedWriter() {
+    try {
+      close();
+    } catch (const mkn::kul::Exception &e) {
+      KERR << e.what();
+    }
+  }
+
+  BufferedWriter &write(char const *c, size_t l) {
+    if (l <= cap - n) {
+      std::memcpy(a.get() + n, c, l);
+      if ((n += l) == cap) drain();
+      return *this;
+    }
+    if (l < cap) {  // fill up the buffer and start the next one
+      auto const k = cap - n;
+      std::memcpy(a.get() + n, c, k);
+      n = cap;
+      drain();
+      std::memcpy(a.get(), c + k, n = l - k);
+      return *this;
+    }
+    // large records go out with the buffer, their tail is kept so later writes stay aligned
+    wait();
+    auto const k = (n + l) / BLOCK * BLOCK - n;
+    raw(a.get(), n, c, k);
+    std::memcpy(a.get(), c + k, n = l - k);
+    return *this;
+  }
+  BufferedWriter &write(std::string_view const &s) { return write(s.data(), s.size()); }
+  BufferedWriter &line(std::string_view const &s) { return write(s).write(eol); }
+  BufferedWriter &operator<<(std::string_view const &s) { return write(s); }
+  BufferedWriter &operator<<(char const c) { return write(&c, 1); }
+  template <class T, std::enable_if_t<std::is_integral_v<T>, bool> = 0>
+  BufferedWriter &operator<<(T const &v) {
+    char s[24];
+    return write(s, std::to_chars(s, s + 24, v).ptr - s);
+  }
+
+  // writes everything, including any partial block
+  BufferedWriter &flush() {
+    wait();
+    if (n) raw(a.get(), n);
+    n = 0;
+    return *this;
+  }
+  void close() {
+    if (!a) return;
+    std::string e;
+    try {
+      flush();
+    } catch (const mkn::kul::Exception &x) {
+      e = x.what();
+    }
+    if (t.joinable()) {
+      {
+        std::lock_guard<std::mutex> l(m);
+        stop = 1;
+      }
+      cv.notify_all();
+      t.join();
+    }
+#ifdef _WIN32
+    CloseHandle(h);
+#else
+    ::close(fd);
+#endif
+    a.reset();
+    if (e.size()) KEXCEPT(Exception, e);
+  }
+};
+
 }  // namespace io
 }  // namespace kul
 }  // namespace mkn
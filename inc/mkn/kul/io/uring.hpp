@@ -0,0 +1,442 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_IO_URING_HPP_
+#define _MKN_KUL_IO_URING_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mkn/kul/future.hpp"
+#include "mkn/kul/io.hpp"
+#include "mkn/kul/threads.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define _MKN_KUL_IO_URING_ 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace mkn {
+namespace kul {
+namespace io {
+namespace uring {
+
+struct Result {
+  mkn::kul::File file;
+  std::vector<uint8_t> data;  // contents read, or the data written
+  size_t bytes = 0;
+  int error = 0;  // errno, 0 on success
+};
+using Callback = std::function<void(Result &&)>;
+
+namespace detail {
+
+struct Op {
+  Result r;
+  Callback cb;
+  int fd = -1;
+  bool write = 0;
+#ifndef _WIN32
+  iovec v{};
+#endif
+};
+
+#if defined(_MKN_KUL_IO_URING_)
+// minimal io_uring over the raw syscalls, one submitter at a time and one reaper
+class Ring {
+ private:
+  int fd = -1;
+  unsigned *sh, *st, *sm, *sa, *ch, *ct, *cm;
+  unsigned se = 0, ce = 0, queued = 0;
+  io_uring_sqe *sqes = nullptr;
+  io_uring_cqe *cqes = nullptr;
+  void *sp = MAP_FAILED, *cp = MAP_FAILED, *qp = MAP_FAILED;
+  size_t ss = 0, cs = 0, qs = 0;
+
+  static unsigned *at(void *p, unsigned const o) {
+    return reinterpret_cast<unsigned *>(static_cast<char *>(p) + o);
+  }
+  void free() {
+    if (qp != MAP_FAILED) munmap(qp, qs);
+    if (cp != MAP_FAILED && cp != sp) munmap(cp, cs);
+    if (sp != MAP_FAILED) munmap(sp, ss);
+    if (fd >= 0) ::close(fd);
+  }
+
+ public:
+  Ring(unsigned const entries) {
+    io_uring_params p{};
+    fd = int(syscall(__NR_io_uring_setup, entries, &p));
+    if (fd < 0) KEXCEPT(Exception, "io_uring_setup failed: " + std::string(strerror(errno)));
+    ss = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cs = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool const single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) ss = cs = std::max(ss, cs);
+    sp = mmap(nullptr, ss, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+              IORING_OFF_SQ_RING);
+    cp = single || sp == MAP_FAILED ? sp
+                                    : mmap(nullptr, cs, PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    qs = p.sq_entries * sizeof(io_uring_sqe);
+    if (cp != MAP_FAILED)
+      qp = mmap(nullptr, qs, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                IORING_OFF_SQES);
+    if (qp == MAP_FAILED) {
+      free();
+      KEXCEPT(Exception, "io_uring mmap failed: " + std::string(strerror(errno)));
+    }
+    sh = at(sp, p.sq_off.head), st = at(sp, p.sq_off.tail), sm = at(sp, p.sq_off.ring_mask);
+    sa = at(sp, p.sq_off.array), se = p.sq_entries;
+    ch = at(cp, p.cq_off.head), ct = at(cp, p.cq_off.tail), cm = at(cp, p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(static_cast<char *>(cp) + p.cq_off.cqes);
+    ce = p.cq_entries;
+    sqes = static_cast<io_uring_sqe *>(qp);
+  }
+  Ring(Ring const &) = delete;
+  Ring &operator=(Ring const &) = delete;
+  ~Ring() { free(); }
+
+  unsigned completions() const { return ce; }
+
+  // false if the submission queue is full, submit() then retry
+  bool push(uint8_t const op, int const _fd, iovec *v, uint64_t const off, void *data) {
+    unsigned const t = *st;
+    if (t - __atomic_load_n(sh, __ATOMIC_ACQUIRE) == se) return false;
+    unsigned const i = t & *sm;
+    io_uring_sqe &e(sqes[i]);
+    std::memset(&e, 0, sizeof(e));
+    e.opcode = op;
+    e.fd = _fd;
+    e.addr = reinterpret_cast<uint64_t>(v);
+    e.len = v ? 1 : 0;
+    e.off = off;
+    e.user_data = reinterpret_cast<uint64_t>(data);
+    sa[i] = i;
+    __atomic_store_n(st, t + 1, __ATOMIC_RELEASE);
+    queued++;
+    return true;
+  }
+  void submit() {
+    while (queued) {
+      int const r = int(syscall(__NR_io_uring_enter, fd, queued, 0, 0, nullptr, 0));
+      if (r < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+        KEXCEPT(Exception, "io_uring_enter failed: " + std::string(strerror(errno)));
+      }
+      queued -= r;
+    }
+  }
+  // blocks for at least one completion, f(user_data, res) for each
+  template <class F>
+  void reap(F &&f) {
+    unsigned h = *ch;
+    while (h == __atomic_load_n(ct, __ATOMIC_ACQUIRE)) {
+      syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      h = *ch;
+    }
+    for (unsigned const t = __atomic_load_n(ct, __ATOMIC_ACQUIRE); h != t; h++) {
+      auto const &c(cqes[h & *cm]);
+      auto const d = c.user_data;
+      auto const r = c.res;
+      __atomic_store_n(ch, h + 1, __ATOMIC_RELEASE);
+      f(reinterpret_cast<Op *>(d), r);
+    }
+  }
+};
+#endif  // _MKN_KUL_IO_URING_
+
+}  // namespace detail
+
+// reads and writes whole files in batches through io_uring where the kernel allows it,
+//  otherwise with blocking calls on a thread pool
+// callbacks run on the completion thread, or on pool threads, and must not block for long
+//  nor submit more work from the completion thread
+class Engine {
+ private:
+  std::mutex sm, m;  // submission, inflight
+  std::condition_variable cv;
+  size_t inflight = 0, limit;
+  std::atomic<bool> stop{0};
+#if defined(_MKN_KUL_IO_URING_)
+  std::unique_ptr<detail::Ring> ring;
+#endif
+  std::unique_ptr<WorkStealingPool<>> pool;
+  std::thread reaper;
+
+  // reads may end early if the file shrinks, writes may not
+  static void finish(detail::Op *op, int const error) {
+    if (op->fd >= 0) ::close(op->fd);
+    op->r.error = error || !op->write || op->r.bytes == op->r.data.size() ? error : EIO;
+    if (!op->write && !error) op->r.data.resize(op->r.bytes);
+    if (op->cb) op->cb(std::move(op->r));
+    delete op;
+  }
+  void done(size_t const n = 1) {
+    std::lock_guard<std::mutex> l(m);
+    inflight -= n;
+    cv.notify_all();
+  }
+
+  detail::Op *open(File const &f, Callback const &cb, std::vector<uint8_t> *data) {
+    auto op = new detail::Op();
+    op->r.file = f;
+    op->cb = cb;
+    op->write = data;
+    auto const path = f.full();
+#ifdef _WIN32
+    op->fd = data ? _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644)
+                  : _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    op->fd = data ? ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                  : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (op->fd < 0) {
+      finish(op, errno);
+      return nullptr;
+    }
+    if (data)
+      op->r.data = std::move(*data);
+    else {
+#ifdef _WIN32
+      op->r.data.resize(f.size());
+#else
+      struct stat st;
+      if (fstat(op->fd, &st) != 0) {
+        finish(op, errno);
+        return nullptr;
+      }
+      op->r.data.resize(st.st_size);
+#endif
+    }
+    if (op->r.data.empty()) {
+      finish(op, 0);
+      return nullptr;
+    }
+    return op;
+  }
+  // bytes left to do
+#ifndef _WIN32
+  static iovec *left(detail::Op *op) {
+    op->v.iov_base = op->r.data.data() + op->r.bytes;
+    op->v.iov_len = op->r.data.size() - op->r.bytes;
+    return &op->v;
+  }
+#endif
+  void blocking(detail::Op *op) {
+    int error = 0;
+    while (op->r.bytes < op->r.data.size()) {
+      auto *p = op->r.data.data() + op->r.bytes;
+      auto const n = op->r.data.size() - op->r.bytes;
+#ifdef _WIN32
+      _lseek(op->fd, long(op->r.bytes), SEEK_SET);
+      auto const r = op->write ? _write(op->fd, p, unsigned(n)) : _read(op->fd, p, unsigned(n));
+#else
+      auto const r = op->write ? ::pwrite(op->fd, p, n, op->r.bytes)
+                               : ::pread(op->fd, p, n, op->r.bytes);
+#endif
+      if (r < 0 && errno == EINTR) continue;
+      if (r < 0) error = errno;
+      if (r <= 0) break;
+      op->r.bytes += r;
+    }
+    finish(op, error);
+  }
+
+  // waits for room, ops are counted as in flight from here
+  void reserve(size_t const n) {
+    std::unique_lock<std::mutex> l(m);
+    cv.wait(l, [&]() { return inflight + n <= limit || inflight == 0; });
+    inflight += n;
+  }
+  void submit(std::vector<detail::Op *> const &ops) {
+    if (ops.empty()) return;
+    reserve(ops.size());
+#if defined(_MKN_KUL_IO_URING_)
+    if (ring) {
+      std::lock_guard<std::mutex> l(sm);
+      for (auto *op : ops) {
+        auto const code = op->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        while (!ring->push(code, op->fd, left(op), op->r.bytes, op)) ring->submit();
+      }
+      ring->submit();
+      return;
+    }
+#endif
+    for (auto *op : ops)
+      pool->async([this, op]() {
+        blocking(op);
+        done();
+      });
+  }
+
+#if defined(_MKN_KUL_IO_URING_)
+  void complete(detail::Op *op, int const res) {
+    if (res > 0) {
+      op->r.bytes += res;
+      if (op->r.bytes < op->r.data.size()) {  // short, queue the rest
+        std::lock_guard<std::mutex> l(sm);
+        auto const code = op->write ? IORING_OP_WRITEV : IORING_OP_READV;
+        while (!ring->push(code, op->fd, left(op), op->r.bytes, op)) ring->submit();
+        ring->submit();
+        return;
+      }
+    }
+    finish(op, res < 0 ? -res : 0);
+    done();
+  }
+  void reap() {
+    while (!stop) {
+      ring->reap([&](detail::Op *op, int const res) {
+        if (op) complete(op, res);
+      });
+    }
+  }
+#endif
+
+ public:
+  // native false forces the thread pool, threads 0 is one per hardware thread
+  Engine(size_t const depth = 256, size_t const threads = 0, bool const native = 1)
+      : limit(depth ? depth : 1) {
+#if defined(_MKN_KUL_IO_URING_)
+    if (native) {
+      try {
+        ring = std::make_unique<detail::Ring>(unsigned(limit));
+        limit = ring->completions();
+        reaper = std::thread(&Engine::reap, this);
+        return;
+      } catch (const Exception &) {
+        ring.reset();
+      }
+    }
+#else
+    (void)native;
+#endif
+    pool = std::make_unique<WorkStealingPool<>>(threads ? threads : cpu::threads(), 1);
+  }
+  Engine(Engine const &) = delete;
+  Engine &operator=(Engine const &) = delete;
+  ~Engine() {
+    wait();
+    stop = 1;
+#if defined(_MKN_KUL_IO_URING_)
+    if (ring) {
+      {
+        std::lock_guard<std::mutex> l(sm);
+        while (!ring->push(IORING_OP_NOP, -1, nullptr, 0, nullptr)) ring->submit();
+        ring->submit();
+      }
+      reaper.join();
+    }
+#endif
+    if (pool) pool->finish().join();
+  }
+
+  bool native() const {
+#if defined(_MKN_KUL_IO_URING_)
+    return ring.get();
+#else
+    return false;
+#endif
+  }
+
+  // files that cannot be opened complete immediately on the calling thread
+  void read(std::vector<File> const &files, Callback const &cb) {
+    std::vector<detail::Op *> ops;
+    ops.reserve(std::min(files.size(), limit));
+    for (auto const &f : files) {
+      if (auto *op = open(f, cb, nullptr)) ops.push_back(op);
+      if (ops.size() == limit) {
+        submit(ops);
+        ops.clear();
+      }
+    }
+    submit(ops);
+  }
+  void read(File const &f, Callback const &cb) { read(std::vector<File>{f}, cb); }
+  void write(File const &f, std::vector<uint8_t> &&data, Callback const &cb) {
+    if (auto *op = open(f, cb, &data)) submit({op});
+  }
+
+  Future<std::vector<uint8_t>> read(File const &f) {
+    auto p = std::make_shared<Promise<std::vector<uint8_t>>>();
+    auto fut = p->future();
+    read(f, [p](Result &&r) {
+      if (r.error)
+        p->except(error(r));
+      else
+        p->set(std::move(r.data));
+    });
+    return fut;
+  }
+  Future<size_t> write(File const &f, std::vector<uint8_t> &&data) {
+    auto p = std::make_shared<Promise<size_t>>();
+    auto fut = p->future();
+    write(f, std::move(data), [p](Result &&r) {
+      if (r.error)
+        p->except(error(r));
+      else
+        p->set(r.bytes);
+    });
+    return fut;
+  }
+
+  // until everything submitted so far has completed
+  void wait() {
+    std::unique_lock<std::mutex> l(m);
+    cv.wait(l, [&]() { return inflight == 0; });
+  }
+
+  static std::exception_ptr error(Result const &r) {
+    return std::make_exception_ptr(
+        Exception(__FILE__, __LINE__, r.file.full() + " : " + std::string(strerror(r.error))));
+  }
+};
+
+}  // namespace uring
+}  // namespace io
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_IO_URING_HPP_ */
@@ -32,8 +32,21 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _MKN_KUL_LOG_HPP_
 
 #include <string.h>
+#include <atomic>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include "mkn/kul/os.hpp"
 #include "mkn/kul/os/threads.hpp"
@@ -47,6 +60,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define __MKN_KUL_LOG_FRMT__ "[%M]: %T - %D : %F fn(%N)#%L - %S"
 #endif
 
+#ifndef __MKN_KUL_LOG_LEVEL__
+#define __MKN_KUL_LOG_LEVEL__ 5
+#endif
+
 namespace mkn {
 namespace kul {
 namespace log {
@@ -57,6 +74,453 @@ class Exception : public mkn::kul::Exception {
  public:
   Exception(char const *f, uint16_t const &l, std::string const &s) : mkn::kul::Exception(f, l, s) {}
 };
+
+// swallows a message so a disabled KLOG is a void expression with unevaluated operands
+struct Voidify {
+  template <class T>
+  void operator&(T const &) const {}
+};
+
+inline char const *TXT(const mode &m) {
+  static char const *const txt[] = {"NON", "INF", "ERR", "DBG", "OTH", "TRC"};
+  return m > NON && m <= TRC ? txt[m] : txt[0];
+}
+
+inline std::string const &TID() {
+  static thread_local std::string const tid(mkn::kul::this_thread::id());
+  return tid;
+}
+
+// strftime once per second, "%i" is filled in from the timestamp
+class Clock {
+ private:
+  std::vector<std::string> f, p;  // format split on "%i", and each part formatted
+  std::time_t sec = -1;
+  uint16_t ms = 1000;
+  std::string s;
+
+ public:
+  Clock(std::string const &_f = __MKN_KUL_LOG_TIME_FRMT__) {
+    size_t b = 0, i;
+    while ((i = _f.find("%i", b)) != std::string::npos) {
+      f.emplace_back(_f.substr(b, i - b));
+      b = i + 2;
+    }
+    f.emplace_back(_f.substr(b));
+    p.resize(f.size());
+  }
+  // nanoseconds since epoch
+  std::string const &at(uint64_t const &nanos) {
+    std::time_t const t = nanos / 1000000000;
+    uint16_t const m = (nanos / 1000000) % 1000;
+    if (t == sec && m == ms) return s;
+    if (t != sec) {
+      struct tm ti;
+#ifdef _WIN32
+      localtime_s(&ti, &t);
+#else
+      localtime_r(&t, &ti);
+#endif
+      char buffer[80];
+      for (size_t i = 0; i < f.size(); i++)
+        p[i].assign(buffer, f[i].empty() ? 0 : std::strftime(buffer, 80, f[i].c_str(), &ti));
+      sec = t;
+    }
+    ms = m;
+    char const d[3] = {char('0' + m / 100), char('0' + m / 10 % 10), char('0' + m % 10)};
+    s = p[0];
+    for (size_t i = 1; i < p.size(); i++) s.append(d, 3).append(p[i]);
+    return s;
+  }
+  static Clock &THREAD() {
+    static thread_local Clock c;
+    return c;
+  }
+};
+
+// log format compiled once into literal and field ops, see __MKN_KUL_LOG_FRMT__
+class Format {
+ private:
+  enum class Field : uint8_t { LIT, MODE, TID, DATE, FILE, FUNC, LINE, STR };
+  struct Op {
+    Field f;
+    size_t off, len;
+  };
+  std::string const fmt;
+  std::vector<Op> ops;
+
+ public:
+  Format(std::string const &_fmt) : fmt(_fmt) {
+    size_t b = 0;
+    auto const literal = [&](size_t const e) {
+      if (e > b) ops.push_back(Op{Field::LIT, b, e - b});
+    };
+    for (size_t i = 0; i + 1 < fmt.size(); i++) {
+      if (fmt[i] != '%') continue;
+      Field f;
+      switch (fmt[i + 1]) {
+        case 'M':
+          f = Field::MODE;
+          break;
+        case 'T':
+          f = Field::TID;
+          break;
+        case 'D':
+          f = Field::DATE;
+          break;
+        case 'F':
+          f = Field::FILE;
+          break;
+        case 'N':
+          f = Field::FUNC;
+          break;
+        case 'L':
+          f = Field::LINE;
+          break;
+        case 'S':
+          f = Field::STR;
+          break;
+        default:
+          continue;
+      }
+      literal(i);
+      ops.push_back(Op{f, 0, 0});
+      b = ++i + 1;
+    }
+    literal(fmt.size());
+  }
+  std::string const &str() const { return fmt; }
+
+  void write(std::string &out, char const *f, char const *fn, uint16_t const &l,
+             std::string_view const &s, const mode &m, std::string_view const &tid,
+             std::string_view const &time) const {
+    for (auto const &op : ops) {
+      switch (op.f) {
+        case Field::LIT:
+          out.append(fmt, op.off, op.len);
+          break;
+        case Field::MODE:
+          out += TXT(m);
+          break;
+        case Field::TID:
+          out += tid;
+          break;
+        case Field::DATE:
+          out += time;
+          break;
+        case Field::FILE:
+          out += f;
+          break;
+        case Field::FUNC:
+          out += fn;
+          break;
+        case Field::LINE: {
+          char b[8];
+          out.append(b, std::to_chars(b, b + 8, l).ptr);
+          break;
+        }
+        case Field::STR:
+          out += s;
+          break;
+      }
+    }
+  }
+
+  static Format const &DEFAULT() {
+    static Format const f(__MKN_KUL_LOG_FRMT__);
+    return f;
+  }
+};
+
+// typed message arguments, as written by deferred and binary logging
+enum class Arg : uint8_t { STR = 0, I64, U64, F64, CHAR, PTR };
+
+template <class T>
+void put(std::string &b, T const &t) {
+  b.append(reinterpret_cast<char const *>(&t), sizeof(T));
+}
+inline void put(std::string &b, std::string_view const &s) {
+  put(b, Arg::STR);
+  put(b, uint32_t(s.size()));
+  b.append(s.data(), s.size());
+}
+template <class T>
+void arg(std::string &b, T const &t) {
+  if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+                std::is_same_v<T, unsigned char>) {
+    put(b, Arg::CHAR);
+    put(b, char(t));
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    put(b, Arg::I64);
+    put(b, int64_t(t));
+  } else if constexpr (std::is_integral_v<T>) {
+    put(b, Arg::U64);
+    put(b, uint64_t(t));
+  } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+    put(b, Arg::F64);
+    put(b, double(t));
+  } else if constexpr (std::is_convertible_v<T const &, std::string_view>) {
+    put(b, std::string_view(t));
+  } else if constexpr (std::is_pointer_v<T>) {
+    put(b, Arg::PTR);
+    put(b, static_cast<void const *>(t));
+  } else {  // anything else is formatted by the caller
+    static thread_local std::stringstream ss;
+    ss.str("");
+    ss.precision(22);
+    ss << t;
+    put(b, std::string_view(ss.str()));
+  }
+}
+
+// bounds checked reads of encoded arguments and records
+class Reader {
+ private:
+  char const *p, *e;
+
+ public:
+  Reader(char const *_p, size_t const &n) : p(_p), e(_p + n) {}
+  template <class T>
+  bool get(T &t) {
+    if (size_t(e - p) < sizeof(T)) return false;
+    std::memcpy(&t, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+  }
+  bool bytes(std::string_view &s) {
+    uint32_t n;
+    return get(n) && skip(n, s);
+  }
+  bool get(std::string_view &s) {
+    Arg a;
+    return get(a) && a == Arg::STR && bytes(s);
+  }
+  bool skip(size_t const &n, std::string_view &s) {
+    if (size_t(e - p) < n) return false;
+    s = std::string_view(p, n);
+    p += n;
+    return true;
+  }
+  size_t left() const { return e - p; }
+  bool done() const { return p == e; }
+};
+
+// writes the remaining arguments as text, false if they are malformed
+inline bool print(Reader &rd, std::ostream &os) {
+  auto const prec = os.precision(22);
+  auto const as = [&](auto t) {
+    if (!rd.get(t)) return false;
+    os << t;
+    return true;
+  };
+  bool ok = 1;
+  while (ok && !rd.done()) {
+    Arg a;
+    if (!rd.get(a)) return false;
+    switch (a) {
+      case Arg::STR: {
+        std::string_view sv;
+        ok = rd.bytes(sv);
+        if (ok) os << sv;
+        break;
+      }
+      case Arg::I64:
+        ok = as(int64_t());
+        break;
+      case Arg::U64:
+        ok = as(uint64_t());
+        break;
+      case Arg::F64:
+        ok = as(double());
+        break;
+      case Arg::CHAR:
+        ok = as(char());
+        break;
+      case Arg::PTR:
+        ok = as(static_cast<void const *>(nullptr));
+        break;
+      default:
+        ok = 0;
+    }
+  }
+  os.precision(prec);
+  return ok;
+}
+
+namespace bin {
+
+// binary log stream, host endian, starting with MAGIC and VERSION then records of
+//  STR  u32 id, u32 length, bytes                 : file, function and thread names
+//  SITE u32 id, u32 file, u32 function, u16 line  : a logging call site
+//  LOG  u32 site, u64 nanos, u32 thread, i8 mode, u32 length, arguments
+enum Kind : uint8_t { STR = 1, SITE, LOG };
+constexpr char MAGIC[4] = {'K', 'U', 'L', 'B'};
+constexpr uint8_t VERSION = 1;
+
+class Writer {
+ private:
+  std::mutex mute;
+  std::function<void(char const *, size_t)> w;
+  FILE *file = nullptr;
+  std::unordered_map<void const *, uint32_t> strs;  // names are string literals
+  std::unordered_map<std::string, uint32_t> tids;
+  std::map<std::tuple<uint32_t, uint32_t, uint16_t>, uint32_t> sites;
+  uint32_t ids = 0;
+  std::string b;
+
+  uint32_t str(std::string_view const &s) {
+    put(b, STR);
+    put(b, ++ids);
+    put(b, uint32_t(s.size()));
+    b.append(s.data(), s.size());
+    return ids;
+  }
+  uint32_t name(char const *s) {
+    auto it = strs.find(s);
+    if (it != strs.end()) return it->second;
+    return strs.emplace(s, str(s)).first->second;
+  }
+  uint32_t tid(std::string const &s) {
+    auto it = tids.find(s);
+    if (it != tids.end()) return it->second;
+    return tids.emplace(s, str(s)).first->second;
+  }
+  uint32_t site(char const *f, char const *fn, uint16_t const &l) {
+    auto const key = std::make_tuple(name(f), name(fn), l);
+    auto it = sites.find(key);
+    if (it != sites.end()) return it->second;
+    put(b, SITE);
+    put(b, ++ids);
+    put(b, std::get<0>(key));
+    put(b, std::get<1>(key));
+    put(b, l);
+    return sites.emplace(key, ids).first->second;
+  }
+
+ public:
+  Writer(std::function<void(char const *, size_t)> const &_w) : w(_w) {
+    b.append(MAGIC, 4);
+    put(b, VERSION);
+    w(b.data(), b.size());
+  }
+  Writer(std::string const &path) : file(fopen(path.c_str(), "wb")) {
+    if (!file) KEXCEPT(Exception, "Cannot open binary log file: " + path);
+    w = [this](char const *s, size_t n) { fwrite(s, 1, n, file); };
+    b.append(MAGIC, 4);
+    put(b, VERSION);
+    w(b.data(), b.size());
+  }
+  Writer(Writer const &) = delete;
+  Writer &operator=(Writer const &) = delete;
+  ~Writer() {
+    if (file) fclose(file);
+  }
+
+  // args as encoded by log::arg
+  void log(char const *f, char const *fn, uint16_t const &l, const mode &m,
+           std::string const &args) {
+    auto const ns = Now::NANOS();
+    std::lock_guard<std::mutex> lock(mute);
+    b.clear();
+    auto const s = site(f, fn, l);
+    auto const t = tid(TID());
+    put(b, LOG);
+    put(b, s);
+    put(b, ns);
+    put(b, t);
+    put(b, int8_t(m));
+    put(b, uint32_t(args.size()));
+    b += args;
+    w(b.data(), b.size());
+  }
+  void flush() {
+    std::lock_guard<std::mutex> lock(mute);
+    if (file) fflush(file);
+  }
+};
+
+// renders a binary log stream back to text, input may be given in any sized pieces
+class Decoder {
+ private:
+  struct Site {
+    uint32_t f, fn;
+    uint16_t l;
+  };
+  Format const fmt;
+  Clock clock;
+  std::unordered_map<uint32_t, std::string> strs;
+  std::unordered_map<uint32_t, Site> sites;
+  std::string in;
+  std::stringstream ss;
+  bool head = 0;
+
+  std::string const &name(uint32_t const &id) const {
+    auto it = strs.find(id);
+    if (it == strs.end()) KEXCEPT(Exception, "Unknown string id in binary log");
+    return it->second;
+  }
+  // false if the record is incomplete
+  bool record(Reader &rd, std::string &out) {
+    uint8_t k;
+    uint32_t id;
+    if (!rd.get(k) || !rd.get(id)) return false;
+    if (k == STR) {
+      std::string_view s;
+      if (!rd.bytes(s)) return false;
+      strs[id] = std::string(s);
+    } else if (k == SITE) {
+      Site site;
+      if (!rd.get(site.f) || !rd.get(site.fn) || !rd.get(site.l)) return false;
+      sites[id] = site;
+    } else if (k == LOG) {
+      uint64_t ns;
+      uint32_t t, n;
+      int8_t m;
+      std::string_view args;
+      if (!rd.get(ns) || !rd.get(t) || !rd.get(m) || !rd.get(n)) return false;
+      if (!rd.skip(n, args)) return false;
+      auto it = sites.find(id);
+      if (it == sites.end()) KEXCEPT(Exception, "Unknown call site in binary log");
+      Reader ar(args.data(), args.size());
+      ss.str("");
+      if (!print(ar, ss)) KEXCEPT(Exception, "Malformed arguments in binary log");
+      auto const &site(it->second);
+      fmt.write(out, name(site.f).c_str(), name(site.fn).c_str(), site.l, ss.str(), mode(m),
+                name(t), clock.at(ns));
+      out += mkn::kul::os::EOL();
+    } else
+      KEXCEPT(Exception, "Unknown record in binary log");
+    return true;
+  }
+
+ public:
+  Decoder(std::string const &_fmt = __MKN_KUL_LOG_FRMT__,
+          std::string const &time = __MKN_KUL_LOG_TIME_FRMT__)
+      : fmt(_fmt), clock(time) {}
+
+  // appends the text of each complete record to out, incomplete trailing bytes are kept
+  void decode(char const *p, size_t const n, std::string &out) {
+    in.append(p, n);
+    size_t done = 0;
+    if (!head) {
+      if (in.size() < 5) return;
+      if (in.compare(0, 4, MAGIC, 4) || uint8_t(in[4]) != VERSION)
+        KEXCEPT(Exception, "Not a binary log stream, or an unsupported version");
+      head = 1;
+      done = 5;
+    }
+    for (;;) {
+      Reader rd(in.data() + done, in.size() - done);
+      if (!record(rd, out)) break;
+      done = in.size() - rd.left();
+    }
+    in.erase(0, done);
+  }
+  // true if a record was cut short
+  bool partial() const { return !in.empty(); }
+};
+
+}  // namespace bin
 }  // namespace log
 
 class ALogMan;
@@ -65,32 +529,29 @@ class Logger {
 
  protected:
   std::function<void(std::string const &)> e, o;
-  const std::string modeTxt(const log::mode &m) const {
-    std::string s("NON");
-    if (m == 1)
-      s = "INF";
-    else if (m == 2)
-      s = "ERR";
-    else if (m == 3)
-      s = "DBG";
-    else if (m == 4)
-      s = "OTH";
-    else if (m == 5)
-      s = "TRC";
-    return s;
+  const std::string modeTxt(const log::mode &m) const { return log::TXT(m); }
+
+  // reused per thread, moved out while in use so logging from an out/err callback is safe
+  static std::string &BUFFER() {
+    static thread_local std::string b;
+    return b;
   }
 
  public:
   virtual ~Logger() {}
   void str(char const *f, char const *fn, uint16_t const &l, std::string const &s,
            const log::mode &m, std::string &str) {
-    mkn::kul::String::REPLACE(str, "%M", modeTxt(m));
-    mkn::kul::String::REPLACE(str, "%T", mkn::kul::this_thread::id());
-    mkn::kul::String::REPLACE(str, "%D", mkn::kul::DateTime::NOW(__MKN_KUL_LOG_TIME_FRMT__));
-    mkn::kul::String::REPLACE(str, "%F", f);
-    mkn::kul::String::REPLACE(str, "%N", fn);
-    mkn::kul::String::REPLACE(str, "%L", std::to_string(l));
-    mkn::kul::String::REPLACE(str, "%S", s);
+    this->str(f, fn, l, s, m, str, log::TID(), log::Clock::THREAD().at(Now::NANOS()));
+  }
+  // for messages formatted away from the thread and time they were logged at
+  void str(char const *f, char const *fn, uint16_t const &l, std::string const &s,
+           const log::mode &m, std::string &str, std::string const &tid, std::string const &time) {
+    std::string o;
+    if (str == log::Format::DEFAULT().str())
+      log::Format::DEFAULT().write(o, f, fn, l, s, m, tid, time);
+    else
+      log::Format(str).write(o, f, fn, l, s, m, tid, time);
+    str.swap(o);
   }
   virtual void err(std::string const &s) {
     if (e)
@@ -106,9 +567,13 @@ class Logger {
   }
   void log(char const *f, char const *fn, uint16_t const &l, std::string const &s,
            const log::mode &m) {
-    std::string st(__MKN_KUL_LOG_FRMT__);
-    str(f, fn, l, s, m, st);
-    out(st + mkn::kul::os::EOL());
+    std::string b(std::move(BUFFER()));
+    b.clear();
+    log::Format::DEFAULT().write(b, f, fn, l, s, m, log::TID(),
+                                 log::Clock::THREAD().at(Now::NANOS()));
+    b += mkn::kul::os::EOL();
+    out(b);
+    BUFFER() = std::move(b);
   }
   void setOut(std::function<void(std::string const &)> _o) { this->o = _o; }
   void setErr(std::function<void(std::string const &)> _e) { this->e = _e; }
@@ -116,42 +581,132 @@ class Logger {
 
 class ALogMan {
  protected:
-  log::mode m;
+  log::mode m, top;  // top is the most verbose of m and the module modes
   mutable std::unique_ptr<Logger> logger;
-  ALogMan(Logger *_logger) : m(mkn::kul::log::mode::NON), logger(_logger) {
+  std::vector<std::pair<std::string, log::mode>> mods;
+  std::atomic<size_t> nmods{0};
+  std::atomic<uint32_t> gen{0};
+  mutable std::mutex mute;
+
+  ALogMan(Logger *_logger) : m(mkn::kul::log::mode::NON), top(m), logger(_logger) {
     std::string s(mkn::kul::env::GET("KLOG"));
-    if (s.size()) {
-      mkn::kul::String::TRIM(s);
-      if (s == "-1" || s == "OFF")
-        m = log::mode::OFF;
-      else if (s == "0" || s == "NON")
-        m = log::mode::NON;
-      else if (s == "1" || s == "INF")
-        m = log::mode::INF;
-      else if (s == "2" || s == "ERR")
-        m = log::mode::ERR;
-      else if (s == "3" || s == "DBG")
-        m = log::mode::DBG;
-      else if (s == "4" || s == "OTH")
-        m = log::mode::OTH;
-      else if (s == "5" || s == "TRC")
-        m = log::mode::TRC;
-      else {
-        m = log::mode::ERR;
-        out(m, "ERROR DISCERNING LOG LEVEL, ERROR LEVEL IN USE");
+    if (s.size() && !setMode(s)) {
+      setMode(log::mode::ERR);
+      out(m, "ERROR DISCERNING LOG LEVEL, ERROR LEVEL IN USE");
+    }
+    std::string b(mkn::kul::env::GET("KLOG_BIN"));
+    if (b.size()) {
+      try {
+        bin = std::make_unique<log::bin::Writer>(b);
+      } catch (const log::Exception &e) {
+        err(e.what());
       }
     }
   }
+  std::unique_ptr<log::bin::Writer> bin;
+
+  static bool MODE(std::string s, log::mode &_m) {
+    mkn::kul::String::TRIM(s);
+    if (s == "-1" || s == "OFF")
+      _m = log::mode::OFF;
+    else if (s == "0" || s == "NON")
+      _m = log::mode::NON;
+    else if (s == "1" || s == "INF")
+      _m = log::mode::INF;
+    else if (s == "2" || s == "ERR")
+      _m = log::mode::ERR;
+    else if (s == "3" || s == "DBG")
+      _m = log::mode::DBG;
+    else if (s == "4" || s == "OTH")
+      _m = log::mode::OTH;
+    else if (s == "5" || s == "TRC")
+      _m = log::mode::TRC;
+    else
+      return false;
+    return true;
+  }
+  // "io" matches io.hpp and io.os.hpp in any directory, "nix/io.hpp" matches the end of the path
+  static bool MATCH(std::string_view const &f, std::string const &k) {
+    if (k.find_first_of("/\\.") != std::string::npos)
+      return f.size() >= k.size() && f.substr(f.size() - k.size()) == k;
+    auto const b = f.find_last_of("/\\");
+    auto const n = f.substr(b == std::string_view::npos ? 0 : b + 1);
+    return n.substr(0, n.find('.')) == k;
+  }
+  void resolve() {
+    top = m;
+    for (auto const &p : mods)
+      if (p.second > top) top = p.second;
+    nmods = mods.size();
+    gen++;
+  }
+  // cached per thread and file, until modes change
+  log::mode module(char const *f) const {
+    struct Cached {
+      ALogMan const *o = nullptr;
+      uint32_t g = 0;
+      log::mode m = log::mode::NON;
+    };
+    static thread_local std::unordered_map<char const *, Cached> cache;
+    auto const g = gen.load();
+    auto &c(cache[f]);
+    if (c.o != this || c.g != g) {
+      std::lock_guard<std::mutex> lock(mute);
+      c = Cached{this, g, m};
+      for (auto const &p : mods)
+        if (MATCH(f, p.first)) c.m = p.second;
+    }
+    return c.m;
+  }
 
  public:
   virtual ~ALogMan() {}
-  void setMode(const log::mode &m1) { m = m1; }
+  void setMode(const log::mode &m1) {
+    std::lock_guard<std::mutex> lock(mute);
+    m = m1;
+    resolve();
+  }
+  // messages from files matching module use this mode rather than the global one
+  void setMode(std::string const &module, const log::mode &m1) {
+    std::lock_guard<std::mutex> lock(mute);
+    mods.emplace_back(module, m1);
+    resolve();
+  }
+  // as KLOG, a mode optionally followed by module overrides "ERR,io:DBG,proc:TRC"
+  //  returns false and changes nothing if any part is not understood
+  bool setMode(std::string const &s) {
+    log::mode g = m;
+    std::vector<std::pair<std::string, log::mode>> ms;
+    for (auto const &p : mkn::kul::String::SPLIT(s, ',')) {
+      auto const c = p.find(':');
+      log::mode pm;
+      if (!MODE(c == std::string::npos ? p : p.substr(c + 1), pm)) return false;
+      if (c == std::string::npos)
+        g = pm;
+      else
+        ms.emplace_back(p.substr(0, c), pm);
+    }
+    std::lock_guard<std::mutex> lock(mute);
+    m = g;
+    for (auto &p : ms) {
+      mkn::kul::String::TRIM(p.first);
+      mods.emplace_back(std::move(p));
+    }
+    resolve();
+    return true;
+  }
   bool inf() { return m >= log::INF; }
   bool err() { return m >= log::ERR; }
   bool dbg() { return m >= log::DBG; }
+  bool enabled(const log::mode &_m) const { return m >= _m; }
+  // f being __FILE__ of the caller, for module modes
+  bool enabled(char const *f, const log::mode &_m) const {
+    if (top < _m) return false;
+    return nmods.load(std::memory_order_relaxed) ? module(f) >= _m : m >= _m;
+  }
   void log(char const *f, char const *fn, uint16_t const &l, const log::mode &_m,
            std::string const &s) {
-    if (this->m >= _m) logger->log(f, fn, l, s, _m);
+    if (enabled(f, _m)) logger->log(f, fn, l, s, _m);
   }
   void out(const log::mode &_m, std::string const &s) {
     if (this->m >= _m) logger->out(s + mkn::kul::os::EOL());
@@ -165,6 +720,17 @@ class ALogMan {
   }
   void setOut(std::function<void(std::string const &)> o) { logger->setOut(o); }
   void setErr(std::function<void(std::string const &)> e) { logger->setErr(e); }
+
+  // KLOG messages go to the binary stream rather than text, to be set before logging starts
+  void setBinary(std::function<void(char const *, size_t)> const &w) {
+    bin = std::make_unique<log::bin::Writer>(w);
+  }
+  void setBinary(std::string const &path) { bin = std::make_unique<log::bin::Writer>(path); }
+  bool binary() const { return bin.get(); }
+  void logBinary(char const *f, char const *fn, uint16_t const &l, const log::mode &_m,
+                 std::string const &args) {
+    if (enabled(f, _m)) bin->log(f, fn, l, _m, args);
+  }
 };
 
 class LogMan : public ALogMan {
@@ -197,34 +763,56 @@ class Message {
 class LogMessage : public Message {
  public:
   LogMessage(char const *_f, char const *_fn, uint16_t const &_l, const log::mode &_m)
-      : Message(_m), f(_f), fn(_fn), l(_l) {}
-  ~LogMessage() { LogMan::INSTANCE().log(f, fn, l, m, ss.str()); }
+      : Message(_m), f(_f), fn(_fn), l(_l), bin(LogMan::INSTANCE().binary()) {
+    if (!bin) return;
+    b = std::move(BUFFER());
+    b.clear();
+  }
+  ~LogMessage() {
+    if (!bin) {
+      LogMan::INSTANCE().log(f, fn, l, m, ss.str());
+      return;
+    }
+    LogMan::INSTANCE().logBinary(f, fn, l, m, b);
+    BUFFER() = std::move(b);
+  }
+  template <class T>
+  LogMessage &operator<<(const T &s) {
+    if (bin)
+      log::arg(b, s);
+    else
+      ss << s;
+    return *this;
+  }
 
  private:
   char const *f, *fn;
   uint16_t const &l;
-};
-class DBgMessage : public Message {
- public:
-  ~DBgMessage() { KUL_DEBUG_DO(LogMan::INSTANCE().log(f, fn, l, m, ss.str())); }
+  bool const bin;
+  std::string b;  // encoded arguments in binary mode
 
+  static std::string &BUFFER() {
+    static thread_local std::string b;
+    return b;
+  }
+};
 #if !defined(NDEBUG)
+class DBgMessage : public LogMessage {
+ public:
   DBgMessage(char const *_f, char const *_fn, uint16_t const &_l, const log::mode &_m)
-      : Message(_m), f(_f), fn(_fn), l(_l) {}
+      : LogMessage(_f, _fn, _l, _m) {}
+};
 #else
+class DBgMessage : public Message {
+ public:
   DBgMessage() : Message(mkn::kul::log::mode::NON) {}
-#endif
 
   template <class T>
   DBgMessage &operator<<([[maybe_unused]] const T &s) {
-    KUL_DEBUG_DO(ss << s;)
     return *this;
   }
-
- private:
-  KUL_DEBUG_DO(char const *f, *fn;)
-  KUL_DEBUG_DO(uint16_t const &l;)
 };
+#endif
 class OutMessage : public Message {
  public:
   ~OutMessage() { LogMan::INSTANCE().out(m, ss.str()); }
@@ -249,21 +837,39 @@ class DBoMessage : public Message {
 }  // namespace kul
 }  // namespace mkn
 
+// prefixes a message so its operands are only evaluated if sev is enabled for this file
+#define KUL_LOG_IF(man, sev)                                                  \
+  !((sev) <= __MKN_KUL_LOG_LEVEL__ && man::INSTANCE().enabled(__FILE__, sev)) \
+      ? (void)0                                                               \
+      : mkn::kul::log::Voidify() &
+
 #if !defined(_MKN_KUL_DISABLE_KLOG_DEF_) || _MKN_KUL_DISABLE_KLOG_DEF_ == 1
 
-#define KLOG_NON mkn::kul::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::NON)
-#define KLOG_INF mkn::kul::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::INF)
-#define KLOG_ERR mkn::kul::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::ERR)
+#define KLOG_NON                                                               \
+  KUL_LOG_IF(mkn::kul::LogMan, mkn::kul::log::mode::NON)                       \
+  mkn::kul::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::NON)
+#define KLOG_INF                                                               \
+  KUL_LOG_IF(mkn::kul::LogMan, mkn::kul::log::mode::INF)                       \
+  mkn::kul::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::INF)
+#define KLOG_ERR                                                               \
+  KUL_LOG_IF(mkn::kul::LogMan, mkn::kul::log::mode::ERR)                       \
+  mkn::kul::LogMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::ERR)
 #define KLOG(sev) KLOG_##sev
 
 #if !defined(NDEBUG)
-#define KLOG_DBG mkn::kul::DBgMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::DBG)
-#define KLOG_OTH mkn::kul::DBgMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::OTH)
-#define KLOG_TRC mkn::kul::DBgMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::TRC)
+#define KLOG_DBG                                                               \
+  KUL_LOG_IF(mkn::kul::LogMan, mkn::kul::log::mode::DBG)                       \
+  mkn::kul::DBgMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::DBG)
+#define KLOG_OTH                                                               \
+  KUL_LOG_IF(mkn::kul::LogMan, mkn::kul::log::mode::OTH)                       \
+  mkn::kul::DBgMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::OTH)
+#define KLOG_TRC                                                               \
+  KUL_LOG_IF(mkn::kul::LogMan, mkn::kul::log::mode::TRC)                       \
+  mkn::kul::DBgMessage(__FILE__, __func__, __LINE__, mkn::kul::log::mode::TRC)
 #else
-#define KLOG_DBG mkn::kul::DBgMessage()
-#define KLOG_OTH mkn::kul::DBgMessage()
-#define KLOG_TRC mkn::kul::DBgMessage()
+#define KLOG_DBG true ? (void)0 : mkn::kul::log::Voidify() & mkn::kul::DBgMessage()
+#define KLOG_OTH true ? (void)0 : mkn::kul::log::Voidify() & mkn::kul::DBgMessage()
+#define KLOG_TRC true ? (void)0 : mkn::kul::log::Voidify() & mkn::kul::DBgMessage()
 #endif
 
 #define KOUT_NON mkn::kul::OutMessage()
@@ -0,0 +1,148 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_MPMC_HPP_
+#define _MKN_KUL_MPMC_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace mkn {
+namespace kul {
+
+// bounded lock free multi producer multi consumer ring buffer, N must be a power of two
+//  see Vyukov "Bounded MPMC queue"
+template <class T, size_t N>
+class MPMCQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "MPMCQueue size must be a power of two");
+
+ private:
+  static constexpr size_t LINE = 64;
+
+  struct alignas(LINE) Cell {
+    std::atomic<size_t> seq;
+    alignas(T) unsigned char b[sizeof(T)];
+    T *get() { return std::launder(reinterpret_cast<T *>(b)); }
+  };
+
+  alignas(LINE) std::atomic<size_t> _push;
+  alignas(LINE) std::atomic<size_t> _pop;
+  alignas(LINE) std::unique_ptr<Cell[]> _cells;
+
+  static void backoff(size_t const &i) {
+    if (i > 16) std::this_thread::yield();
+  }
+
+  MPMCQueue(MPMCQueue const &) = delete;
+  MPMCQueue &operator=(MPMCQueue const &) = delete;
+
+ public:
+  MPMCQueue() : _push(0), _pop(0), _cells(new Cell[N]) {
+    for (size_t i = 0; i < N; i++) _cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+  ~MPMCQueue() {
+    for (size_t i = _pop; i != _push; i++) {
+      auto &c(_cells[i & (N - 1)]);
+      if (c.seq == i + 1) c.get()->~T();
+    }
+  }
+
+  // false if full, args are untouched on failure
+  template <class... Args>
+  bool try_emplace(Args &&... args) {
+    size_t p = _push.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &c(_cells[p & (N - 1)]);
+      auto d = intptr_t(c.seq.load(std::memory_order_acquire)) - intptr_t(p);
+      if (d == 0) {
+        if (_push.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) {
+          new (c.b) T(std::forward<Args>(args)...);
+          c.seq.store(p + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (d < 0)
+        return false;
+      else
+        p = _push.load(std::memory_order_relaxed);
+    }
+  }
+  bool try_push(T const &t) { return try_emplace(t); }
+  bool try_push(T &&t) { return try_emplace(std::move(t)); }
+
+  // false if empty
+  bool try_pop(T &t) {
+    size_t p = _pop.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &c(_cells[p & (N - 1)]);
+      auto d = intptr_t(c.seq.load(std::memory_order_acquire)) - intptr_t(p + 1);
+      if (d == 0) {
+        if (_pop.compare_exchange_weak(p, p + 1, std::memory_order_relaxed)) {
+          t = std::move(*c.get());
+          c.get()->~T();
+          c.seq.store(p + N, std::memory_order_release);
+          return true;
+        }
+      } else if (d < 0)
+        return false;
+      else
+        p = _pop.load(std::memory_order_relaxed);
+    }
+  }
+
+  // spin then yield until there is space/an element
+  void push(T const &t) {
+    for (size_t i = 0; !try_push(t); i++) backoff(i);
+  }
+  void push(T &&t) {
+    for (size_t i = 0; !try_push(std::move(t)); i++) backoff(i);
+  }
+  void pop(T &t) {
+    for (size_t i = 0; !try_pop(t); i++) backoff(i);
+  }
+
+  // approximate while other threads are pushing or popping
+  size_t size() const {
+    auto pop = _pop.load(std::memory_order_acquire);
+    auto push = _push.load(std::memory_order_acquire);
+    return push > pop ? push - pop : 0;
+  }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+};
+
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_MPMC_HPP_ */
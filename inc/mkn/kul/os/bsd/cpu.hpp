@@ -74,6 +74,7 @@ inline uint32_t cores() {
   return numCPU;
 }
 inline uint16_t threads() { return std::thread::hardware_concurrency(); }
+inline Topology topology() { return Topology::FLAT(threads()); }
 }  // namespace cpu
 }  // namespace kul
 }  // namespace mkn
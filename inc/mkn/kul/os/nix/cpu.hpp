@@ -42,6 +42,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <unistd.h>
 #include <algorithm>
 #include <fstream>
+#include <map>
+#include <string>
 #include <thread>
 
 namespace mkn {
@@ -49,8 +51,28 @@ namespace kul {
 namespace cpu {
 inline uint32_t cores() { return sysconf(_SC_NPROCESSORS_ONLN); }
 inline uint16_t threads() { return std::thread::hardware_concurrency(); }
+
+class SysParser {
+ private:
+  static inline std::vector<uint32_t> LIST(std::string const &file);
+  static inline void TOPOLOGY(std::vector<Cpu> &cpus);
+
+  friend Topology topology();
+};
+
+// read from /sys/devices/system/{cpu,node}, flat if unavailable
+inline Topology topology() {
+  std::vector<Cpu> cpus;
+  SysParser::TOPOLOGY(cpus);
+  if (cpus.empty()) return Topology::FLAT(threads());
+  return Topology(std::move(cpus));
+}
 }  // namespace cpu
 }  // namespace kul
 }  // namespace mkn
 
+#ifndef _MKN_KUL_COMPILED_LIB_
+#include "mkn/kul/os/nix/src/cpu/topology.ipp"
+#endif
+
 #endif /* _MKN_KUL_OS_NIX_CPU_HPP_ */
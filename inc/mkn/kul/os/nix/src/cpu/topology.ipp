@@ -0,0 +1,74 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+// IWYU pragma: private, include "mkn/kul/cpu.hpp"
+
+// "0-3,8,10-11"
+std::vector<uint32_t> mkn::kul::cpu::SysParser::LIST(std::string const& file) {
+  std::vector<uint32_t> v;
+  std::ifstream in(file);
+  std::string s;
+  if (!in || !std::getline(in, s)) return v;
+  char const* p = s.c_str();
+  while (*p) {
+    char* e = nullptr;
+    auto a = strtoul(p, &e, 10), b = a;
+    if (e == p) break;
+    if (*e == '-') b = strtoul(e + 1, &e, 10);
+    for (auto c = a; c <= b; c++) v.push_back(c);
+    if (*e != ',') break;
+    p = e + 1;
+  }
+  return v;
+}
+
+void mkn::kul::cpu::SysParser::TOPOLOGY(std::vector<Cpu>& cpus) {
+  std::string const sys("/sys/devices/system/");
+  auto read = [](std::string const& file, long d) {
+    std::ifstream in(file);
+    long v = d;
+    if (!(in >> v) || v < 0) v = d;
+    return static_cast<uint32_t>(v);
+  };
+  std::map<uint32_t, uint32_t> nodes;
+  for (auto const& n : LIST(sys + "node/online"))
+    for (auto const& c : LIST(sys + "node/node" + std::to_string(n) + "/cpulist")) nodes[c] = n;
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t> cores;
+  for (auto const& id : LIST(sys + "cpu/online")) {
+    auto const t(sys + "cpu/cpu" + std::to_string(id) + "/topology/");
+    Cpu c;
+    c.id = id;
+    c.socket = read(t + "physical_package_id", 0);
+    auto core = cores.emplace(std::make_pair(c.socket, read(t + "core_id", id)), cores.size());
+    c.core = core.first->second;
+    c.node = nodes.count(id) ? nodes[id] : 0;
+    cpus.push_back(c);
+  }
+}
@@ -52,6 +52,7 @@ std::string mkn::kul::Dir::ESC(std::string s) {
 }
 bool mkn::kul::Dir::is() const {
   if (path().empty()) return false;
+  if (fs::StatCache::ENABLED()) return fs::StatCache::INSTANCE().stat(path()).dir();
   DIR *d = opendir(path().c_str());
   if (d) closedir(d);
   return d;
@@ -66,6 +67,7 @@ bool mkn::kul::Dir::root() const { return is() && real().size() == 1; }
 
 bool mkn::kul::File::is() const {
   if (name().empty()) return false;
+  if (fs::StatCache::ENABLED()) return fs::StatCache::INSTANCE().stat(_d.join(_n)).file();
   struct stat buffer;
   if (stat(_d.join(_n).c_str(), &buffer) == 0) return S_ISREG(buffer.st_mode);
   return 0;
@@ -86,6 +88,10 @@ bool mkn::kul::File::mk() const {
 }
 uint64_t mkn::kul::File::size() const {
   uint64_t r = 0;
+  if (fs::StatCache::ENABLED()) {
+    auto const s = fs::StatCache::INSTANCE().stat(mini());
+    return s.ok ? s.size : r;
+  }
   struct stat att;
   if (stat(mini().c_str(), &att) != -1) r = att.st_size;
   return r;
@@ -44,6 +44,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <fstream>
 #include <thread>
 
+#include "mkn/kul/fs/stat.hpp"
+
 namespace mkn {
 namespace kul {
 
@@ -53,6 +55,11 @@ namespace fs {
 class KulTimeStampsResolver {
  private:
   static void GET(char const *const p, uint64_t &a, uint64_t &c, uint64_t &m) {
+    if (StatCache::ENABLED()) {
+      auto const s = StatCache::INSTANCE().stat(p);
+      if (s.ok) a = s.atime, m = s.mtime, c = 0;
+      return;
+    }
     struct stat att;
     if (stat(p, &att) != -1) {
       a = att.st_atime;
@@ -63,6 +70,13 @@ class KulTimeStampsResolver {
   friend class mkn::kul::Dir;
 };
 
+// d_type where the filesystem gives it, links are followed
+inline bool IS_DIR(DIR *d, struct dirent const *e) {
+  if (e->d_type != DT_UNKNOWN && e->d_type != DT_LNK) return e->d_type == DT_DIR;
+  struct stat st;
+  return fstatat(dirfd(d), e->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+}
+
 }  // namespace fs
 }  // namespace kul
 }  // namespace mkn
@@ -33,6 +33,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _MKN_KUL_OS_NIXISH_PROC_HPP_
 #define _MKN_KUL_OS_NIXISH_PROC_HPP_
 
+#include <poll.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+
 #include <memory>
 #include <queue>
 #include <sstream>
@@ -49,6 +53,12 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #error unresolved
 #endif
 
+extern char **environ;
+
+#ifndef __MKN_KUL_PROC_CHUNK__
+#define __MKN_KUL_PROC_CHUNK__ 65536
+#endif  //__MKN_KUL_PROC_CHUNK__
+
 #ifndef __MKN_KUL_PROC_DUP_RETRY__
 #define __MKN_KUL_PROC_DUP_RETRY__ 3
 #endif  //__MKN_KUL_PROC_DUP_RETRY__
@@ -62,8 +72,10 @@ inline void kill(const int32_t &e) { ::kill(mkn::kul::this_proc::id(), e); }
 }  // namespace this_proc
 
 class Process : public mkn::kul::AProcess {
+  friend class mkn::kul::proc::Scheduler;
+
  private:
-  int inFd[2], outFd[2], errFd[2], popPip[3];
+  int inFd[2] = {-1, -1}, outFd[2] = {-1, -1}, errFd[2] = {-1, -1}, popPip[3];
   int cStat;  // child status
 
   inline int16_t recall(int16_t const &_s) {
@@ -90,10 +102,13 @@ class Process : public mkn::kul::AProcess {
 
  protected:
   int16_t inline child();
+  bool inline spawn() KTHROW(mkn::kul::proc::Exception);
+  void inline poll() KTHROW(mkn::kul::proc::Exception);
   virtual void inline expand(std::string &) const;
   void inline waitForStatus();
   void inline waitExit() KTHROW(mkn::kul::proc::ExitException);
   void inline tearDown();
+  void inline launch() KTHROW(mkn::kul::proc::Exception);
   void inline run() KTHROW(mkn::kul::proc::Exception);
 
   virtual void finish() {}
@@ -105,7 +120,9 @@ class Process : public mkn::kul::AProcess {
 #ifndef _MKN_KUL_COMPILED_LIB_
 #include "mkn/kul/os/nixish/src/proc/child.ipp"
 #include "mkn/kul/os/nixish/src/proc/expand.ipp"
+#include "mkn/kul/os/nixish/src/proc/poll.ipp"
 #include "mkn/kul/os/nixish/src/proc/run.ipp"
+#include "mkn/kul/os/nixish/src/proc/spawn.ipp"
 #include "mkn/kul/os/nixish/src/proc/tearDown.ipp"
 #include "mkn/kul/os/nixish/src/proc/waitExit.ipp"
 #include "mkn/kul/os/nixish/src/proc/waitForStatus.ipp"
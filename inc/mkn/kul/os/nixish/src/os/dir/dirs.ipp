@@ -34,14 +34,14 @@ std::vector<mkn::kul::Dir> mkn::kul::Dir::dirs(bool incHidden) const KTHROW(fs::
   if (!is()) KEXCEPT(fs::Exception, "Directory : \"" + path() + "\" does not exist");
   std::vector<Dir> dirs;
 
-  DIR *dir = opendir(real().c_str());
+  std::string const r(real());
+  DIR *dir = opendir(r.c_str());
   struct dirent *entry = readdir(dir);
   while (entry != NULL) {
     std::string d(entry->d_name);
-    mkn::kul::Dir dd(JOIN(real(), entry->d_name));
     if (d.compare(".") != 0 && d.compare("..") != 0 &&
-        !(d.substr(0, 1).compare(".") == 0 && !incHidden) && dd.is())
-      dirs.push_back(dd);
+        !(d.substr(0, 1).compare(".") == 0 && !incHidden) && fs::IS_DIR(dir, entry))
+      dirs.push_back(mkn::kul::Dir(JOIN(r, entry->d_name)));
     entry = readdir(dir);
   }
   closedir(dir);
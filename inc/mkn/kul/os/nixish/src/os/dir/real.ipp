@@ -31,6 +31,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // IWYU pragma: private, include "mkn/kul/os.hpp"
 
 std::string mkn::kul::Dir::REAL(const std::string& s) KTHROW(fs::Exception) {
+  if (fs::StatCache::ENABLED()) {
+    std::string dir;
+    if (fs::StatCache::INSTANCE().real(s, dir)) return dir;
+    KEXCEPT(fs::Exception, "Directory \"" + s + "\" does not exist");
+  }
   char* expanded = realpath(s.c_str(), NULL);
   if (expanded) {
     std::string dir(expanded);
@@ -0,0 +1,89 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+// IWYU pragma: private, include "mkn/kul/proc.hpp"
+
+// waits on the output pipes, and a pidfd for the exit where the kernel has them, so a quiet
+//  child costs nothing. Without a pidfd waitpid is checked on a timeout backing off to 100ms
+void mkn::kul::Process::poll() KTHROW(mkn::kul::proc::Exception) {
+  int pfd = -1;
+#if defined(SYS_pidfd_open)
+  pfd = int(syscall(SYS_pidfd_open, pid(), 0));
+#endif
+  struct pollfd fds[3] = {{popPip[1], POLLIN, 0}, {popPip[2], POLLIN, 0}, {pfd, POLLIN, 0}};
+  nfds_t const nfds = pfd < 0 ? 2 : 3;
+
+  std::string b(__MKN_KUL_PROC_CHUNK__, '\0'), c;
+  // false at EOF, chunks are handed over whole and the buffer grows while reads fill it
+  auto const drain = [&](size_t const i) {
+    for (;;) {
+      ssize_t const n = read(fds[i].fd, &b[0], b.size());
+      if (n > 0) {
+        c.assign(b.data(), n);  // reuses its allocation
+        (i ? err(c) : out(c));
+        if (size_t(n) == b.size() && b.size() < (size_t(__MKN_KUL_PROC_CHUNK__) << 4))
+          b.resize(b.size() * 2);
+        continue;
+      }
+      if (n == 0) return false;
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+      error(__LINE__, "read on child " + std::string(i ? "err" : "out") + " failed");
+    }
+  };
+
+  size_t open = 2;
+  bool exited = 0, reaped = 0;
+  int timeout = pfd < 0 ? 1 : -1;
+  while (open && !exited) {
+    int const r = ::poll(fds, nfds, timeout);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      if (pfd >= 0) close(pfd);
+      error(__LINE__, "poll on child failed");
+    }
+    for (size_t i = 0; i < 2; i++)
+      if (fds[i].fd >= 0 && fds[i].revents && !drain(i)) fds[i].fd = -1, open--;
+    if (pfd >= 0)
+      exited = fds[2].revents;
+    else if (r == 0) {
+      pid_t w;
+      while ((w = waitpid(pid(), &cStat, WNOHANG)) < 0 && errno == EINTR) {
+      }
+      exited = reaped = w == pid();
+      timeout = std::min(timeout * 2, 100);
+    }
+  }
+  // the child is gone but its own children may hold the pipes, take what is there
+  for (size_t i = 0; i < 2; i++)
+    if (fds[i].fd >= 0) drain(i);
+  if (pfd >= 0) close(pfd);
+  if (!reaped) waitForStatus();
+}
@@ -30,83 +30,44 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 // IWYU pragma: private, include "mkn/kul/proc.hpp"
 
-void mkn::kul::Process::run() KTHROW(mkn::kul::proc::Exception) {
+// starts the child, the parent is left holding the nonblocking out/err pipes in popPip
+void mkn::kul::Process::launch() KTHROW(mkn::kul::proc::Exception) {
   {
-    int16_t ret = 0;
-    if ((ret = pipe(inFd)) < 0) error(__LINE__, "Failed to pipe in");
-    if ((ret = pipe(outFd)) < 0) error(__LINE__, "Failed to pipe out");
-    if ((ret = pipe(errFd)) < 0) error(__LINE__, "Failed to pipe err");
+    // close on exec so children launched meanwhile on other threads do not hold these open
+    auto const _pipe = [](int *fds) {
+#if defined(__linux__) || defined(__FreeBSD__)
+      return pipe2(fds, O_CLOEXEC);
+#else
+      int const ret = pipe(fds);
+      if (ret == 0)
+        for (size_t i = 0; i < 2; i++) fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+      return ret;
+#endif
+    };
+    if (_pipe(inFd) < 0) error(__LINE__, "Failed to pipe in");
+    if (_pipe(outFd) < 0) error(__LINE__, "Failed to pipe out");
+    if (_pipe(errFd) < 0) error(__LINE__, "Failed to pipe err");
   }
 
   this->preStart();
-  pid(fork());
-  if (pid() > 0) {
-    int16_t ret = 0;
-    if (this->waitForExit()) {  // parent
-      popPip[0] = inFd[1];
-      popPip[1] = outFd[0];
-      popPip[2] = errFd[0];
+  if (!spawn()) pid(fork());
+  if (pid() > 0) {  // parent
+    popPip[0] = inFd[1];
+    popPip[1] = outFd[0];
+    popPip[2] = errFd[0];
 
 #ifdef __MKN_KUL_PROC_BLOCK_ERR__
-      if ((ret = fcntl(popPip[1], F_SETFL, O_NONBLOCK)) < 0)
-        error(__LINE__, "Failed nonblocking for popPip[1]");
-      if ((ret = fcntl(popPip[2], F_SETFL, O_NONBLOCK)) < 0)
-        error(__LINE__, "Failed nonblocking for popPip[2]");
+    int16_t ret = 0;
+    if ((ret = fcntl(popPip[1], F_SETFL, O_NONBLOCK)) < 0)
+      error(__LINE__, "Failed nonblocking for popPip[1]");
+    if ((ret = fcntl(popPip[2], F_SETFL, O_NONBLOCK)) < 0)
+      error(__LINE__, "Failed nonblocking for popPip[2]");
 #else
-      fcntl(popPip[1], F_SETFL, O_NONBLOCK);
-      fcntl(popPip[2], F_SETFL, O_NONBLOCK);
-#endif
-      fd_set childOutFds;
-      FD_ZERO(&childOutFds);
-      FD_SET(popPip[1], &childOutFds);
-      FD_SET(popPip[2], &childOutFds);
-      close(inFd[1]);
-      bool alive = true;
-
-      char cOut[30024] = {'\0'};
-      char cErr[30024] = {'\0'};
-      do {
-#if defined(_MKN_KUL_PROC_LOOP_NSLEEP_) && (_MKN_KUL_PROC_LOOP_NSLEEP_ > 0)
-        mkn::kul::this_thread::nSleep(_MKN_KUL_PROC_LOOP_NSLEEP_);
+    fcntl(popPip[1], F_SETFL, O_NONBLOCK);
+    fcntl(popPip[2], F_SETFL, O_NONBLOCK);
 #endif
-        alive = ::kill(pid(), 0) == 0;
-        if (FD_ISSET(popPip[1], &childOutFds)) {
-          bool b = 0;
-          do {
-            memset(cOut, 0, sizeof(cOut));
-            ret = recall(read(popPip[1], cOut, sizeof(cOut)));
-            cOut[ret > 0 ? ret : 0] = 0;
-            if (ret < 0) {
-              if (b && ((errno != EAGAIN) || (errno != EWOULDBLOCK)))
-                error(__LINE__, "read on childout failed");
-              if (((errno != EAGAIN) || (errno != EWOULDBLOCK))) b = 1;
-            } else if (ret)
-              out(cOut);
-            else
-              waitForStatus();
-          } while (ret > 0);
-        }
-        if (FD_ISSET(popPip[2], &childOutFds)) {
-          bool b = 0;
-          do {
-            memset(cErr, 0, sizeof(cErr));
-            ret = recall(read(popPip[2], cErr, sizeof(cErr)));
-            cErr[ret > 0 ? ret : 0] = 0;
-            if (ret < 0) {
-              if (b && ((errno != EAGAIN) || (errno != EWOULDBLOCK)))
-                error(__LINE__, "read on childout failed");
-              if (((errno != EAGAIN) || (errno != EWOULDBLOCK))) b = 1;
-            } else if (ret)
-              err(cErr);
-            else
-              waitForStatus();
-          } while (ret > 0);
-        }
-        recall(waitpid(pid(), &cStat, WNOHANG));
-      } while (alive);
-
-      waitExit();
-    }
+    // the child's ends, closed here so its exit is seen as EOF
+    for (int *fd : {&inFd[0], &inFd[1], &outFd[1], &errFd[1]}) recall(close(*fd)), *fd = -1;
   } else if (pid() == 0) {  // child
     close(inFd[1]);
     close(outFd[0]);
@@ -136,8 +97,19 @@ void mkn::kul::Process::run() KTHROW(mkn::kul::proc::Exception) {
     for (auto const &ev : vars())
       env::SET(ev.first.c_str(), ev.second.c_str());
 
-    if (!this->directory().empty()) mkn::kul::env::CWD(this->directory());
+    if (!this->directory().empty() && !mkn::kul::env::CWD(this->directory())) {
+      fprintf(stderr, "Failed to change directory to %s\n", this->directory().c_str());
+      exit(127);
+    }
     exit(this->child());
   } else
     error(__LINE__, "Unhandled process id for child: " + std::to_string(pid()));
 }
+
+void mkn::kul::Process::run() KTHROW(mkn::kul::proc::Exception) {
+  launch();
+  if (this->waitForExit()) {
+    poll();
+    waitExit();
+  }
+}
@@ -0,0 +1,114 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+// IWYU pragma: private, include "mkn/kul/proc.hpp"
+
+// posix_spawn, a vfork/clone(CLONE_VM) in glibc and the BSDs, so page tables are not copied
+//  false if the fork path is needed: commands with "$(" are expanded in the child, where the
+//  process variables are set, others are expanded here. Changing directory needs
+//  posix_spawn_file_actions_addchdir_np
+bool mkn::kul::Process::spawn() KTHROW(mkn::kul::proc::Exception) {
+#if defined(_MKN_KUL_PROC_FORK_)
+  return false;
+#else
+  std::string _s(toString());
+  if (_s.find("$(") != std::string::npos) return false;
+  expand(_s);  // in the parent, for subclasses overriding it
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 29)
+  if (!this->directory().empty()) return false;
+#endif
+  std::vector<std::string> cli(mkn::kul::cli::asArgs(_s));
+  if (cli.empty()) return false;
+  std::vector<char *> argV;
+  argV.reserve(cli.size() + 1);
+  for (auto &a : cli) argV.push_back(&a[0]);
+  argV.push_back(NULL);
+
+  // the environment is built here rather than set in the child
+  std::vector<std::string> evs;
+  std::vector<char *> envP;
+  std::string path;
+  bool ownPath = 0;
+  for (char **e = environ; *e; e++) {
+    char const *const eq = strchr(*e, '=');
+    if (eq && vars().count(std::string(*e, eq - *e))) continue;
+    envP.push_back(*e);
+  }
+  evs.reserve(vars().size());
+  for (auto const &ev : vars()) {
+    evs.emplace_back(ev.first + "=" + ev.second);
+    if (ev.first == "PATH") path = ev.second, ownPath = 1;
+  }
+  for (auto &ev : evs) envP.push_back(&ev[0]);
+  envP.push_back(NULL);
+
+  // posix_spawnp searches the parent's PATH, so a PATH given to this process is searched here
+  std::string bin(cli[0]);
+  if (ownPath && bin.find('/') == std::string::npos) {
+    for (auto const &d : mkn::kul::String::SPLIT(path, ':')) {
+      std::string const f((d.empty() ? "." : d) + "/" + cli[0]);
+      if (access(f.c_str(), X_OK) == 0) {
+        bin = f;
+        break;
+      }
+    }
+  }
+
+  posix_spawn_file_actions_t fa;
+  posix_spawn_file_actions_init(&fa);
+  posix_spawn_file_actions_addclose(&fa, inFd[1]);
+  posix_spawn_file_actions_addclose(&fa, outFd[0]);
+  posix_spawn_file_actions_addclose(&fa, errFd[0]);
+  posix_spawn_file_actions_adddup2(&fa, inFd[0], 0);
+  posix_spawn_file_actions_adddup2(&fa, outFd[1], 1);
+  posix_spawn_file_actions_adddup2(&fa, errFd[1], 2);
+  for (int const fd : {inFd[0], outFd[1], errFd[1]})
+    if (fd > 2) posix_spawn_file_actions_addclose(&fa, fd);
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 29)
+  if (!this->directory().empty())
+    posix_spawn_file_actions_addchdir_np(&fa, this->directory().c_str());
+#endif
+  posix_spawnattr_t at;
+  posix_spawnattr_init(&at);
+#ifdef POSIX_SPAWN_USEVFORK
+  posix_spawnattr_setflags(&at, POSIX_SPAWN_USEVFORK);
+#endif
+
+  pid_t p = 0;
+  int const ret = bin.find('/') == std::string::npos
+                      ? posix_spawnp(&p, bin.c_str(), &fa, &at, &argV[0], &envP[0])
+                      : posix_spawn(&p, bin.c_str(), &fa, &at, &argV[0], &envP[0]);
+  posix_spawnattr_destroy(&at);
+  posix_spawn_file_actions_destroy(&fa);
+  if (ret != 0) error(__LINE__, "Failed to spawn " + cli[0] + " : " + strerror(ret));
+  pid(p);
+  return true;
+#endif
+}
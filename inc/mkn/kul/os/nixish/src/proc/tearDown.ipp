@@ -31,13 +31,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // IWYU pragma: private, include "mkn/kul/proc.hpp"
 
 void mkn::kul::Process::tearDown() {
-  recall(close(popPip[0]));
-  recall(close(popPip[1]));
-  recall(close(popPip[2]));
-  recall(close(errFd[1]));
-  recall(close(errFd[0]));
-  recall(close(outFd[1]));
-  recall(close(outFd[0]));
-  recall(close(inFd[1]));
-  recall(close(inFd[0]));
+  // popPip only aliases these, each is closed once and left -1
+  for (int *fd : {&errFd[1], &errFd[0], &outFd[1], &outFd[0], &inFd[1], &inFd[0]})
+    if (*fd >= 0) recall(close(*fd)), *fd = -1;
 }
@@ -129,6 +129,20 @@ class Thread : public threading::AThread {
     if (s) KEXCEPTION("Thread running");
     f = 0;
     s = 1;
+#if defined(__linux__)
+    if (cpus.size()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (auto const &c : cpus)
+        if (c < CPU_SETSIZE) CPU_SET(c, &set);
+      pthread_attr_t att;
+      pthread_attr_init(&att);
+      pthread_attr_setaffinity_np(&att, sizeof(set), &set);
+      auto r = pthread_create(&thr, &att, Thread::threadFunction, this);
+      pthread_attr_destroy(&att);
+      if (r == 0) return;  // otherwise cpus may be outside this process's cpuset, run unpinned
+    }
+#endif
     pthread_create(&thr, NULL, Thread::threadFunction, this);
   }
 };
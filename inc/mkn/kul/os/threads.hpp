@@ -41,6 +41,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <memory>
 #include <queue>
 #include <thread>
+#include <vector>
 
 #include "mkn/kul/defs.hpp"
 #include "mkn/kul/except.hpp"
@@ -77,6 +78,7 @@ class AThread {
  protected:
   std::atomic<bool> f, s;
   std::exception_ptr ep;
+  std::vector<uint32_t> cpus;
 
   AThread() : f(1), s(0) {}
   virtual void run() KTHROW(mkn::kul::threading::Exception) = 0;
@@ -87,6 +89,11 @@ class AThread {
   bool started() const { return s; }
   bool finished() const { return f; }
   auto& exception() const { return ep; }
+  // logical cpus to pin to when next run, empty for no pinning
+  AThread& affinity(std::vector<uint32_t> const& _cpus) {
+    cpus = _cpus;
+    return *this;
+  }
   void rethrow() {
     if (ep) std::rethrow_exception(ep);
   }
@@ -109,7 +109,15 @@ class Thread : public threading::AThread {
     if (s) KEXCEPTION("Thread running");
     f = 0;
     s = 1;
-    h = CreateThread(0, 5120000, threading::threadFunction, this, 0, 0);
+    h = CreateThread(0, 5120000, threading::threadFunction, this,
+                     cpus.size() ? CREATE_SUSPENDED : 0, 0);
+    if (cpus.size()) {
+      DWORD_PTR mask = 0;
+      for (auto const &c : cpus)
+        if (c < sizeof(DWORD_PTR) * 8) mask |= DWORD_PTR(1) << c;
+      if (mask) SetThreadAffinityMask(h, mask);
+      ResumeThread(h);
+    }
   }
 };
 
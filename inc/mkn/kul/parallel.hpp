@@ -0,0 +1,165 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_PARALLEL_HPP_
+#define _MKN_KUL_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "mkn/kul/except.hpp"
+#include "mkn/kul/span.hpp"
+
+#ifndef __MKN_KUL_PARALLEL_CHUNKS__
+#define __MKN_KUL_PARALLEL_CHUNKS__ 4
+#endif /*  __MKN_KUL_PARALLEL_CHUNKS__ */
+
+// Pool is expected to be a WorkStealingPool or ConcurrentThreadPool, anything with
+//  size(), async(f) and help(), the calling thread works through chunks alongside the pool
+
+namespace mkn {
+namespace kul {
+namespace parallel {
+namespace detail {
+
+struct Plan {
+  Plan(size_t const &threads, size_t const &_n, size_t const &grain) : n(_n) {
+    size_t const chunks = threads * __MKN_KUL_PARALLEL_CHUNKS__;
+    size = (n + chunks - 1) / chunks;
+    size = std::max(size, grain ? grain : size_t{1});
+    count = n ? (n + size - 1) / size : 0;
+  }
+  size_t n, size, count;
+};
+
+template <class Body>
+class Chunks {
+ public:
+  Chunks(Plan const &_p, Body &_body) : p(_p), body(_body) {}
+  void operator()() {
+    for (size_t c; (c = next++) < p.count; done++) {
+      if (failed) continue;
+      try {
+        body(c, c * p.size, std::min(p.n, (c + 1) * p.size));
+      } catch (...) {
+        std::lock_guard<std::mutex> l(m);
+        if (!ep) ep = std::current_exception();
+        failed = 1;
+      }
+    }
+  }
+
+  Plan const p;
+  Body &body;  // not touched once next >= count, so late helpers outliving the call are safe
+  std::atomic<size_t> next{0}, done{0};
+  std::atomic<bool> failed{0};
+  std::exception_ptr ep;
+  std::mutex m;
+};
+
+template <class Pool, class Body>
+void chunked(Pool &pool, Plan const &plan, Body &&body) {
+  if (plan.count == 0) return;
+  auto s = std::make_shared<Chunks<Body>>(plan, body);
+  auto const helpers = std::min(pool.size(), plan.count - 1);
+  for (size_t i = 0; i < helpers; i++)
+    if (!pool.async([s]() { (*s)(); })) break;
+  (*s)();
+  while (s->done < plan.count)
+    if (!pool.help()) std::this_thread::yield();
+  if (s->ep) std::rethrow_exception(s->ep);
+}
+
+template <class S>
+auto span(S &&s) {
+  return Span<std::remove_pointer_t<decltype(s.data())>>(s.data(), s.size());
+}
+
+}  // namespace detail
+}  // namespace parallel
+
+// f(i) for i in [0, n), iterations are grouped in chunks of at least grain
+template <class Pool, class F>
+void parallel_for(Pool &pool, size_t const &n, F &&f, size_t const &grain = 0) {
+  parallel::detail::Plan plan(pool.size() + 1, n, grain);
+  parallel::detail::chunked(pool, plan, [&](size_t, size_t b, size_t const e) {
+    for (; b < e; b++) f(b);
+  });
+}
+
+// f(e) for each element e of s
+template <class Pool, class S, class F,
+          std::enable_if_t<is_span_like_v<std::remove_reference_t<S>>, bool> = 0>
+void parallel_for(Pool &pool, S &&s, F &&f, size_t const &grain = 0) {
+  auto sp = parallel::detail::span(s);
+  parallel::detail::Plan plan(pool.size() + 1, sp.size(), grain);
+  parallel::detail::chunked(pool, plan, [&](size_t, size_t b, size_t const e) {
+    for (; b < e; b++) f(sp[b]);
+  });
+}
+
+// out[i] = f(in[i])
+template <class Pool, class I, class O, class F>
+void parallel_transform(Pool &pool, I &&in, O &&out, F &&f, size_t const &grain = 0) {
+  auto i = parallel::detail::span(in);
+  auto o = parallel::detail::span(out);
+  if (o.size() < i.size()) KEXCEPT(mkn::kul::Exception, "parallel_transform output is too small");
+  parallel::detail::Plan plan(pool.size() + 1, i.size(), grain);
+  parallel::detail::chunked(pool, plan, [&](size_t, size_t b, size_t const e) {
+    for (; b < e; b++) o[b] = f(i[b]);
+  });
+}
+
+// op(op(op(init, r0), r1), ...) where rN = op(...op(sN[0], sN[1])..., sN[last]) for chunk sN
+//  chunk boundaries only depend on the size of s, the pool and grain so results are repeatable
+template <class Pool, class S, class R, class Op>
+R parallel_reduce(Pool &pool, S &&s, R init, Op &&op, size_t const &grain = 0) {
+  auto sp = parallel::detail::span(s);
+  parallel::detail::Plan plan(pool.size() + 1, sp.size(), grain);
+  std::vector<std::optional<R>> partials(plan.count);
+  parallel::detail::chunked(pool, plan, [&](size_t const c, size_t b, size_t const e) {
+    R r(sp[b++]);
+    for (; b < e; b++) r = op(std::move(r), sp[b]);
+    partials[c].emplace(std::move(r));
+  });
+  for (auto &p : partials) init = op(std::move(init), std::move(*p));
+  return init;
+}
+
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_PARALLEL_HPP_ */
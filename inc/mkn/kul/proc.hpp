@@ -34,6 +34,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <functional>
 #include <iostream>
 #include <sstream>
+#include <string_view>
 #include <vector>
 
 #include "mkn/kul/cli.hpp"
@@ -55,6 +56,8 @@ uint16_t cpuLoad();
 
 namespace proc {
 
+class Scheduler;
+
 class Exception : public mkn::kul::Exception {
  public:
   Exception(char const *f, uint16_t const &l, std::string const &s) : mkn::kul::Exception(f, l, s) {}
@@ -194,21 +197,83 @@ class AProcess {
 
 inline std::ostream &operator<<(std::ostream &s, const AProcess &p) { return s << p.toString(); }
 
+// output is appended to one buffer per stream, outs()/errs() give it without copying
 class ProcessCapture {
+ public:
+  using Line = std::function<void(std::string_view const &)>;
+
  private:
-  std::stringstream so, se;
+  struct Stream {
+    std::string s;
+    size_t cap = std::string::npos;
+    bool cut = 0;
+    Line line;
+
+    void add(std::string const &c) {
+      if (line) {  // only an unfinished last line is kept
+        size_t b = 0, e = s.size();
+        s.append(c);
+        while ((e = s.find('\n', e)) != std::string::npos) {
+          line(std::string_view(s).substr(b, e - b));
+          b = ++e;
+        }
+        s.erase(0, b);
+        return;
+      }
+      if (s.size() + c.size() > cap) {
+        cut = 1;
+        if (s.size() < cap) s.append(c, 0, cap - s.size());
+      } else
+        s.append(c);
+    }
+    void flush() {
+      if (!line) return;
+      if (s.size()) line(s);
+      s.clear();
+    }
+  } so, se;
 
  protected:
   ProcessCapture() {}
-  ProcessCapture(const ProcessCapture &pc) : so(pc.so.str()), se(pc.se.str()) {}
-  virtual void out(std::string const &s) { so << s; }
-  virtual void err(std::string const &s) { se << s; }
+  ProcessCapture(const ProcessCapture &pc) : so(pc.so), se(pc.se) {}
+  virtual void out(std::string const &s) { so.add(s); }
+  virtual void err(std::string const &s) { se.add(s); }
 
  public:
   ProcessCapture(AProcess &p) { setProcess(p); }
   virtual ~ProcessCapture() {}
-  const std::string outs() const { return so.str(); }
-  const std::string errs() const { return se.str(); }
+  std::string const &outs() const { return so.s; }
+  std::string const &errs() const { return se.s; }
+  // moves the captured output out, leaving it empty
+  std::string takeOuts() { return std::move(so.s); }
+  std::string takeErrs() { return std::move(se.s); }
+  // first non empty line of output
+  std::string_view line() const {
+    std::string_view v(so.s);
+    size_t b = v.find_first_not_of('\n');
+    if (b == std::string_view::npos) return {};
+    return v.substr(b, v.find('\n', b) - b);
+  }
+
+  // bytes kept per stream, more is dropped and truncated() is true
+  ProcessCapture &cap(size_t const bytes) {
+    so.cap = se.cap = bytes;
+    return *this;
+  }
+  bool truncated() const { return so.cut || se.cut; }
+  // complete lines are given to o/e as they arrive instead of being kept, without the newline
+  //  a null e leaves errors captured
+  ProcessCapture &lines(Line const &o, Line const &e = nullptr) {
+    so.line = o;
+    se.line = e;
+    return *this;
+  }
+  // gives any last lines without a newline to the line callbacks, once the process is done
+  void flush() {
+    so.flush();
+    se.flush();
+  }
+
   void setProcess(AProcess &p) {
     p.setOut(std::bind(&ProcessCapture::out, std::ref(*this), std::placeholders::_1));
     p.setErr(std::bind(&ProcessCapture::err, std::ref(*this), std::placeholders::_1));
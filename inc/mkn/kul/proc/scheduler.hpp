@@ -0,0 +1,412 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_PROC_SCHEDULER_HPP_
+#define _MKN_KUL_PROC_SCHEDULER_HPP_
+
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mkn/kul/cpu.hpp"
+#include "mkn/kul/env.hpp"
+#include "mkn/kul/future.hpp"
+#include "mkn/kul/proc.hpp"
+#include "mkn/kul/string.hpp"
+
+#ifdef _WIN32
+#include "mkn/kul/threads.hpp"
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace mkn {
+namespace kul {
+namespace proc {
+
+struct Result {
+  int32_t code = -1;
+  std::string out, err;
+};
+
+#ifndef _WIN32
+// GNU make jobserver, a pipe holding one byte per free job slot beyond the implicit one
+class JobServer {
+ private:
+  int r = -1, w = -1, rd = -1;  // rd is a nonblocking read end private to this process
+  bool own = 0;
+  size_t n = 0;
+
+  JobServer() {}
+  // a pipe reopened through /proc is a new open file description, so O_NONBLOCK is not shared
+  //  with others using the jobserver. Without /proc a token read could block, so none is used
+  bool reader() {
+    auto const p = "/proc/self/fd/" + std::to_string(r);
+    return (rd = ::open(p.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)) >= 0;
+  }
+
+ public:
+  JobServer(JobServer const &) = delete;
+  JobServer &operator=(JobServer const &) = delete;
+  ~JobServer() {
+    if (rd >= 0) ::close(rd);
+    if (own) {
+      ::close(r);
+      if (w != r) ::close(w);
+    }
+  }
+
+  // the jobserver of a parent make or Scheduler, from --jobserver-auth=R,W or fifo:PATH
+  //  nullptr if there is none, its descriptors were not inherited or cannot be read privately
+  static std::unique_ptr<JobServer> JOIN(std::string const &flags = env::GET("MAKEFLAGS")) {
+    std::string a;
+    for (auto const &f : String::SPLIT(flags, ' '))
+      for (char const *const k : {"--jobserver-auth=", "--jobserver-fds="})
+        if (f.rfind(k, 0) == 0) a = f.substr(strlen(k));
+    if (a.empty()) return nullptr;
+    std::unique_ptr<JobServer> js(new JobServer());
+    if (a.rfind("fifo:", 0) == 0) {
+      js->r = js->w = ::open(a.substr(5).c_str(), O_RDWR | O_CLOEXEC);
+      if (js->r < 0) return nullptr;
+      js->own = 1;
+    } else {
+      auto const c = a.find(',');
+      if (c == std::string::npos) return nullptr;
+      std::from_chars(a.data(), a.data() + c, js->r);
+      std::from_chars(a.data() + c + 1, a.data() + a.size(), js->w);
+      if (js->r < 0 || js->w < 0 || fcntl(js->r, F_GETFD) < 0 || fcntl(js->w, F_GETFD) < 0)
+        return nullptr;
+    }
+    if (!js->reader()) return nullptr;
+    return js;
+  }
+  // n tokens, n + 1 jobs with the implicit slot. The pipe is inherited by child processes
+  //  nullptr if it cannot be read privately
+  static std::unique_ptr<JobServer> CREATE(size_t const n) {
+    int fds[2];
+    if (::pipe(fds) < 0) KEXCEPT(Exception, "JobServer pipe failed");
+    std::unique_ptr<JobServer> js(new JobServer());
+    js->r = fds[0], js->w = fds[1], js->own = 1, js->n = n;
+    if (!js->reader()) return nullptr;
+    for (size_t i = 0; i < n; i++) js->release('+');
+    return js;
+  }
+
+  // readable when a token may be free
+  int fd() const { return rd; }
+  bool acquire(char &t) {
+    for (;;) {
+      ssize_t const s = ::read(rd, &t, 1);
+      if (s == 1) return true;
+      if (s < 0 && errno == EINTR) continue;
+      return false;
+    }
+  }
+  void release(char const t) {
+    while (::write(w, &t, 1) < 0 && errno == EINTR) {
+    }
+  }
+  // MAKEFLAGS for children if the jobserver was made here
+  std::string flags() const {
+    if (!own || r == w) return "";
+    return "-j" + std::to_string(n + 1) + " --jobserver-auth=" + std::to_string(r) + "," +
+           std::to_string(w);
+  }
+};
+#endif  // _WIN32
+
+// runs up to slots processes at once, the output of all is read on one thread
+//  on nix a jobserver in MAKEFLAGS is joined, or one is made and passed on, so nested makes and
+//  Schedulers share the slots. Processes run in submission order as slots free up
+class Scheduler {
+ private:
+  size_t const slots;
+  size_t live = 0;
+  std::mutex m;
+  std::condition_variable cv;
+
+  void done() {
+    std::lock_guard<std::mutex> l(m);
+    live--;
+    cv.notify_all();
+  }
+
+#ifdef _WIN32
+  ConcurrentThreadPool<> pool;
+
+ public:
+  Scheduler(size_t const _slots = 0, bool const = 1)
+      : slots(_slots ? _slots : cpu::threads()), pool(slots, 1) {}
+  ~Scheduler() {
+    wait();
+    pool.finish().join();
+  }
+
+  template <class P>
+  Future<Result> submit(P &&p) {
+    static_assert(std::is_base_of_v<Process, std::decay_t<P>>, "P must be a Process");
+    auto sp = std::make_shared<std::decay_t<P>>(std::forward<P>(p));
+    {
+      std::lock_guard<std::mutex> l(m);
+      live++;
+    }
+    return pool.submit([this, sp]() {
+      struct Done {
+        Scheduler *s;
+        ~Done() { s->done(); }
+      } d{this};
+      Result r;
+      sp->setOut([&](std::string const &s) { r.out += s; });
+      sp->setErr([&](std::string const &s) { r.err += s; });
+      try {
+        sp->start();
+      } catch (ExitException const &) {
+      }
+      r.code = sp->exitCode();
+      return r;
+    });
+  }
+#else
+  struct Job {
+    std::unique_ptr<Process> p;
+    Promise<Result> pr;
+    Result r;
+    int fds[2] = {-1, -1}, pfd = -1;
+    bool token = 0, implicit = 0, reaped = 0, exited = 0;
+    char t = '+';
+  };
+
+  bool stop = 0, implicit = 0;  // implicit is the slot which needs no jobserver token
+  int wk[2] = {-1, -1};
+  std::unique_ptr<JobServer> js;
+  std::string flags;
+  std::deque<std::unique_ptr<Job>> pending;  // guarded by m
+  std::vector<std::unique_ptr<Job>> running;
+  std::string b = std::string(__MKN_KUL_PROC_CHUNK__, '\0');  // read buffer of the loop
+  std::thread t;
+
+  void wake() {
+    char const c = 0;
+    while (::write(wk[1], &c, 1) < 0 && errno == EINTR) {
+    }
+  }
+
+  // EOF marks the fd done, it is closed by tearDown
+  void read(Job &j, size_t const o) {
+    auto &s = o ? j.r.err : j.r.out;
+    for (;;) {
+      ssize_t const n = ::read(j.fds[o], &b[0], b.size());
+      if (n > 0) {
+        s.append(b.data(), n);
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      if (n == 0) j.fds[o] = -1;
+      return;
+    }
+  }
+  void reap(Job &j, int const flag) {
+    pid_t w;
+    while ((w = waitpid(j.p->pid(), &j.p->cStat, flag)) < 0 && errno == EINTR) {
+    }
+    j.reaped = j.exited = w == j.p->pid() || (w < 0 && errno == ECHILD);
+  }
+
+  void launch(std::unique_ptr<Job> &&j) {
+    try {
+      j->p->launch();
+    } catch (...) {
+      if (j->token) js->release(j->t);
+      if (j->implicit) implicit = 0;
+      j->pr.except(std::current_exception());
+      return done();
+    }
+    j->fds[0] = j->p->popPip[1];
+    j->fds[1] = j->p->popPip[2];
+#if defined(SYS_pidfd_open)
+    j->pfd = int(syscall(SYS_pidfd_open, j->p->pid(), 0));
+#endif
+    running.emplace_back(std::move(j));
+  }
+  // runs pending jobs while there are slots, and tokens once the implicit slot is taken
+  void start() {
+    for (;;) {
+      std::unique_ptr<Job> j;
+      {
+        std::lock_guard<std::mutex> l(m);
+        if (pending.empty() || running.size() >= slots) return;
+        char c = '+';
+        bool const token = js && implicit;
+        if (token && !js->acquire(c)) return;
+        j = std::move(pending.front());
+        pending.pop_front();
+        j->token = token, j->t = c;
+        j->implicit = js && !token;
+        if (j->implicit) implicit = 1;
+      }
+      launch(std::move(j));
+    }
+  }
+  void complete(Job &j) {
+    for (size_t o = 0; o < 2; o++)
+      if (j.fds[o] >= 0) read(j, o);
+    if (j.pfd >= 0) ::close(j.pfd);
+    if (!j.reaped) reap(j, 0);
+    if (j.token) js->release(j.t);
+    if (j.implicit) implicit = 0;
+    try {
+      j.p->waitExit();
+      j.r.code = j.p->exitCode();
+      j.pr.set(std::move(j.r));
+    } catch (...) {
+      j.pr.except(std::current_exception());
+    }
+    done();
+  }
+
+  void loop() {
+    std::vector<struct pollfd> fds;
+    int timeout = 1;
+    for (;;) {
+      start();
+      bool waiting = 0;
+      {
+        std::lock_guard<std::mutex> l(m);
+        if (stop && pending.empty() && running.empty()) return;
+        waiting = js && pending.size() && implicit && running.size() < slots;
+      }
+      bool spin = 0;
+      fds.clear();
+      fds.push_back({wk[0], POLLIN, 0});
+      fds.push_back({waiting ? js->fd() : -1, POLLIN, 0});
+      for (auto const &j : running) {
+        fds.push_back({j->fds[0], POLLIN, 0});
+        fds.push_back({j->fds[1], POLLIN, 0});
+        fds.push_back({j->pfd, POLLIN, 0});
+        spin |= j->pfd < 0;
+      }
+      // without pidfds exits are checked with waitpid on every wake, or a timeout backing off
+      //  to 100ms
+      int const r = ::poll(fds.data(), fds.size(), spin ? timeout : -1);
+      timeout = r == 0 ? std::min(timeout * 2, 100) : 1;
+      if (fds[0].revents) {
+        char c[64];
+        while (::read(wk[0], c, sizeof(c)) > 0) {
+        }
+      }
+      size_t i = 2;
+      for (auto const &j : running) {
+        for (size_t o = 0; o < 2; o++, i++)
+          if (fds[i].revents && j->fds[o] >= 0) read(*j, o);
+        if (fds[i++].revents)
+          j->exited = 1;
+        else if (j->pfd < 0)
+          reap(*j, WNOHANG);
+      }
+      for (size_t k = running.size(); k-- > 0;)
+        if (running[k]->exited) {
+          complete(*running[k]);
+          running[k] = std::move(running.back());
+          running.pop_back();
+        }
+    }
+  }
+
+ public:
+  // slots 0 is one per hardware thread
+  Scheduler(size_t const _slots = 0, bool const jobserver = 1)
+      : slots(_slots ? _slots : cpu::threads()) {
+#if defined(__linux__) || defined(__FreeBSD__)
+    if (::pipe2(wk, O_NONBLOCK | O_CLOEXEC) < 0) KEXCEPT(Exception, "Scheduler pipe failed");
+#else
+    if (::pipe(wk) < 0) KEXCEPT(Exception, "Scheduler pipe failed");
+    for (int const fd : wk) fcntl(fd, F_SETFL, O_NONBLOCK), fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+    if (jobserver) {
+      js = JobServer::JOIN();
+      if (!js && slots > 1 && (js = JobServer::CREATE(slots - 1))) flags = js->flags();
+    }
+    t = std::thread(&Scheduler::loop, this);
+  }
+  Scheduler(Scheduler const &) = delete;
+  Scheduler &operator=(Scheduler const &) = delete;
+  ~Scheduler() {
+    {
+      std::lock_guard<std::mutex> l(m);
+      stop = 1;
+    }
+    wake();
+    t.join();
+    ::close(wk[0]);
+    ::close(wk[1]);
+  }
+
+  // the process is copied or moved in, its output is captured into the result rather than
+  //  given to any handlers it has. Exit codes are not thrown, failing to start is
+  template <class P>
+  Future<Result> submit(P &&p) {
+    static_assert(std::is_base_of_v<Process, std::decay_t<P>>, "P must be a Process");
+    auto j = std::make_unique<Job>();
+    j->p = std::make_unique<std::decay_t<P>>(std::forward<P>(p));
+    if (flags.size() && !j->p->vars().count("MAKEFLAGS")) j->p->var("MAKEFLAGS", flags);
+    auto f = j->pr.future();
+    {
+      std::lock_guard<std::mutex> l(m);
+      pending.emplace_back(std::move(j));
+      live++;
+    }
+    wake();
+    return f;
+  }
+#endif  // _WIN32
+
+ public:
+  // until every submitted process has completed
+  void wait() {
+    std::unique_lock<std::mutex> l(m);
+    cv.wait(l, [&]() { return live == 0; });
+  }
+  size_t size() const { return slots; }
+};
+
+}  // namespace proc
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_PROC_SCHEDULER_HPP_ */
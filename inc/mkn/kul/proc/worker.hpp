@@ -0,0 +1,251 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_PROC_WORKER_HPP_
+#define _MKN_KUL_PROC_WORKER_HPP_
+
+#include <charconv>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mkn/kul/proc.hpp"
+#include "mkn/kul/proc/scheduler.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace mkn {
+namespace kul {
+namespace proc {
+
+// a long lived child given requests on stdin, responses are cut from its stdout by a Frame
+//  requests are written while responses are read, so many can be in flight at once
+//  a child which exits is started again on the next request. Not available on Windows
+class Worker {
+ public:
+  // the length of the first complete response at the start of the buffer, or 0 if incomplete
+  using Frame = std::function<size_t(std::string_view const &)>;
+
+ private:
+  std::vector<std::string> argv;
+  Frame of, ef;  // ef is only set for shells, otherwise stderr is kept for errs()
+  std::string mark, ob, eb;
+  std::string rb = std::string(__MKN_KUL_PROC_CHUNK__, '\0');  // read buffer
+  int fi = -1, fo = -1, fe = -1;
+  pid_t p = 0;
+  std::mutex m;
+
+  void launch() {
+    int in[2], out[2], err[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, in) < 0) KEXCEPT(Exception, "Worker socket failed");
+    if (::pipe(out) < 0 || ::pipe(err) < 0) KEXCEPT(Exception, "Worker pipe failed");
+    for (int const fd : {in[0], in[1], out[0], out[1], err[0], err[1]})
+      fcntl(fd, F_SETFD, FD_CLOEXEC);  // cleared on the child's 0/1/2 by dup2
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, in[1], 0);
+    posix_spawn_file_actions_adddup2(&fa, out[1], 1);
+    posix_spawn_file_actions_adddup2(&fa, err[1], 2);
+    std::vector<char *> args;
+    for (auto &a : argv) args.push_back(&a[0]);
+    args.push_back(nullptr);
+    int const ret = posix_spawnp(&p, args[0], &fa, nullptr, &args[0], environ);
+    posix_spawn_file_actions_destroy(&fa);
+    for (int const fd : {in[1], out[1], err[1]}) ::close(fd);
+    fi = in[0], fo = out[0], fe = err[0];
+    for (int const fd : {fi, fo, fe}) fcntl(fd, F_SETFL, O_NONBLOCK);
+    if (ret != 0) {
+      p = 0;
+      stop();
+      KEXCEPT(Exception, "Failed to spawn " + argv[0] + " : " + strerror(ret));
+    }
+  }
+  void stop() {
+    for (int *fd : {&fi, &fo, &fe})
+      if (*fd >= 0) ::close(*fd), *fd = -1;
+    if (p > 0)
+      while (waitpid(p, nullptr, 0) < 0 && errno == EINTR) {
+      }
+    p = 0;
+    ob.clear();
+    eb.clear();
+  }
+  // false at EOF
+  bool drain(int const fd, std::string &s) {
+    for (;;) {
+      ssize_t const n = ::read(fd, &rb[0], rb.size());
+      if (n > 0) {
+        s.append(rb.data(), n);
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      return n != 0;
+    }
+  }
+  static void cut(std::string &b, Frame const &f, std::vector<std::string> &rs, size_t const n) {
+    size_t o = 0, k;
+    while (rs.size() < n && (k = f(std::string_view(b).substr(o))) > 0) {
+      rs.emplace_back(b, o, k);
+      o += k;
+    }
+    b.erase(0, o);
+  }
+
+  // writes in while reading, until n responses are cut from stdout, and stderr for shells
+  void exchange(std::string const &in, size_t const n, std::vector<std::string> &outs,
+                std::vector<std::string> &errs) {
+    if (p == 0) launch();
+    size_t w = 0;
+    bool dead = 0;
+    while (!dead && (outs.size() < n || (ef && errs.size() < n))) {
+      struct pollfd fds[3] = {
+          {w < in.size() ? fi : -1, POLLOUT, 0}, {fo, POLLIN, 0}, {fe, POLLIN, 0}};
+      if (::poll(fds, 3, -1) < 0) {
+        if (errno == EINTR) continue;
+        KEXCEPT(Exception, "Worker poll failed");
+      }
+      if (fds[0].revents) {  // send as a closed child would raise SIGPIPE on write
+        ssize_t const s = ::send(fi, in.data() + w, in.size() - w, MSG_NOSIGNAL);
+        if (s > 0) w += s;
+        if (s < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) dead = 1;
+      }
+      if (fds[1].revents) {
+        dead |= !drain(fo, ob);
+        cut(ob, of, outs, n);
+      }
+      if (fds[2].revents) {
+        dead |= !drain(fe, eb);
+        if (ef) cut(eb, ef, errs, n);
+      }
+    }
+    if (dead) {
+      stop();
+      KEXCEPT(Exception, "Worker " + argv[0] + " exited");
+    }
+  }
+
+  // output ends at a random marker the shell prints with the status, stderr at another
+  Result result(std::string &&o, std::string &&e) const {
+    Result r;
+    size_t const at = o.rfind(mark);
+    std::from_chars(o.data() + at + mark.size() + 1, o.data() + o.size(), r.code);
+    o.resize(at);
+    e.resize(e.size() - mark.size() - 1);
+    r.out = std::move(o);
+    r.err = std::move(e);
+    return r;
+  }
+  // quoted for eval so a syntax error cannot consume what follows, "command" keeps the shell up
+  std::string command(std::string const &cmd) const {
+    std::string q;
+    q.reserve(cmd.size() + 2);
+    for (char const c : cmd) c == '\'' ? q += "'\\''" : q += c;
+    return "command eval '" + q + "' </dev/null; printf '%s %d\\n' " + mark +
+           " $?; printf '%s\\n' " + mark + " >&2\n";
+  }
+
+ public:
+  // a tool reading requests from stdin, e.g. {"git", "cat-file", "--batch"}
+  Worker(std::vector<std::string> const &_argv, Frame const &frame) : argv(_argv), of(frame) {
+    if (argv.empty()) KEXCEPT(Exception, "Worker needs a command");
+  }
+  // a shell which run() commands are given to, state like the directory is kept between them
+  Worker(std::string const &shell = "/bin/sh") : argv{shell} {
+    std::random_device rd;
+    mark = "__kul_worker_" + std::to_string(rd()) + std::to_string(rd()) + "__";
+    of = [this](std::string_view const &b) -> size_t {
+      size_t const at = b.find(mark);
+      if (at == std::string_view::npos) return 0;
+      size_t const nl = b.find('\n', at + mark.size());
+      return nl == std::string_view::npos ? 0 : nl + 1;
+    };
+    ef = [this](std::string_view const &b) -> size_t {
+      size_t const at = b.find(mark + "\n");
+      return at == std::string_view::npos ? 0 : at + mark.size() + 1;
+    };
+  }
+  Worker(Worker const &) = delete;
+  Worker &operator=(Worker const &) = delete;
+  // the child exits on the end of its input
+  ~Worker() { stop(); }
+
+  std::string request(std::string const &in) { return request(std::vector<std::string>{in})[0]; }
+  std::vector<std::string> request(std::vector<std::string> const &ins) {
+    std::lock_guard<std::mutex> l(m);
+    std::string in;
+    for (auto const &s : ins) in += s;
+    std::vector<std::string> outs, errs;
+    outs.reserve(ins.size());
+    exchange(in, ins.size(), outs, errs);
+    return outs;
+  }
+
+  Result run(std::string const &cmd) { return std::move(run(std::vector<std::string>{cmd})[0]); }
+  std::vector<Result> run(std::vector<std::string> const &cmds) {
+    if (!ef) KEXCEPT(Exception, "Worker is not a shell, use request");
+    std::lock_guard<std::mutex> l(m);
+    std::string in;
+    for (auto const &c : cmds) in += command(c);
+    std::vector<std::string> outs, errs;
+    exchange(in, cmds.size(), outs, errs);
+    std::vector<Result> rs;
+    rs.reserve(cmds.size());
+    for (size_t i = 0; i < cmds.size(); i++)
+      rs.emplace_back(result(std::move(outs[i]), std::move(errs[i])));
+    return rs;
+  }
+
+  // stderr of a tool since last called
+  std::string errs() {
+    std::lock_guard<std::mutex> l(m);
+    if (fe >= 0) drain(fe, eb);
+    std::string e;
+    e.swap(eb);
+    return e;
+  }
+  pid_t pid() const { return p; }
+};
+
+}  // namespace proc
+}  // namespace kul
+}  // namespace mkn
+
+#endif  // _WIN32
+#endif /* _MKN_KUL_PROC_WORKER_HPP_ */
@@ -31,9 +31,15 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _MKN_KUL_SCM_HPP_
 #define _MKN_KUL_SCM_HPP_
 
+#include <algorithm>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include "mkn/kul/map.hpp"
 #include "mkn/kul/os.hpp"
 #include "mkn/kul/proc.hpp"
+#include "mkn/kul/proc/scheduler.hpp"
 #include "mkn/kul/string.hpp"
 
 namespace mkn {
@@ -50,6 +56,32 @@ class NotFoundException : public mkn::kul::Exception {
   NotFoundException(char const *f, uint16_t const &l, std::string const &s)
       : mkn::kul::Exception(f, l, s) {}
 };
+
+// results of a batched query in input order, failures are gathered rather than thrown
+template <class T>
+struct Batch {
+  std::vector<T> values;
+  std::vector<std::string> errors;  // empty for inputs which succeeded
+
+  explicit Batch(size_t const n) : values(n), errors(n) {}
+  bool ok() const {
+    for (auto const &e : errors)
+      if (!e.empty()) return false;
+    return true;
+  }
+  // one exception with every error
+  void raise() const KTHROW(Exception) {
+    std::string s;
+    for (auto const &e : errors)
+      if (!e.empty()) s += e + mkn::kul::os::EOL();
+    if (!s.empty()) KEXCEPT(Exception, s);
+  }
+};
+
+struct Status {
+  std::string branch, version;
+  bool changes = 0;
+};
 }  // namespace scm
 
 class SCM {
@@ -78,6 +110,28 @@ class SCM {
 // review https://gist.github.com/aleksey-bykov/1273f4982c317c92d532
 namespace scm {
 class Git : public SCM {
+ private:
+  // a failed or non zero exit is put in error with what
+  static proc::Result result(mkn::kul::Future<proc::Result> &f, std::string const &what,
+                             std::string &error) {
+    try {
+      auto r = f.get();
+      if (r.code != 0) error = what + " : " + r.err;
+      return r;
+    } catch (std::exception const &e) {
+      error = what + " : " + e.what();
+    }
+    return {};
+  }
+  template <class F>
+  static void each(std::string_view v, F const &f) {  // lines
+    while (!v.empty()) {
+      size_t const e = v.find('\n');
+      f(v.substr(0, e));
+      v.remove_prefix(e == std::string_view::npos ? v.size() : e + 1);
+    }
+  }
+
  public:
   std::string defaultRemoteBranch(std::string const &repo) const override {
     mkn::kul::Process p("git");
@@ -86,12 +140,12 @@ class Git : public SCM {
       << "--symref" << repo << "HEAD";
     ;
     try {
-      KLOG(DBG) << mkn::kul::String::LINES(pc.outs())[0];
       p.start();
+      KLOG(DBG) << pc.line();
     } catch (mkn::kul::proc::ExitException const& e) {
       KEXCEPT(Exception, "SCM ERROR - Checking local branch") << p.toString();
     }
-    auto ret = mkn::kul::String::SPLIT(mkn::kul::String::LINES(pc.outs())[0], "/").back();
+    auto ret = mkn::kul::String::SPLIT(std::string(pc.line()), "/").back();
     return ret.substr(0, ret.size() - 5);  // HEAD+tab
     // e.g. git ls-remote --symref git@github.com:user/repo HEAD
   };
@@ -107,7 +161,7 @@ class Git : public SCM {
     } catch (mkn::kul::proc::ExitException const& e) {
       KEXCEPT(Exception, "SCM ERROR - Checking local branch");
     }
-    return mkn::kul::String::LINES(pc.outs())[0];
+    return std::string(pc.line());
   }
 
   std::string branch(std::string const &d) const { return branch(mkn::kul::Dir(d)); }
@@ -171,7 +225,7 @@ class Git : public SCM {
     }
     if (pc.outs().empty())
       KEXCEPT(Exception, "SCM ERROR: Directory may not be git repository : " + d);
-    return mkn::kul::String::LINES(pc.outs())[0];
+    return std::string(pc.line());
   }
 
   std::string remoteVersion(std::string const &url, std::string const &b) const
@@ -186,7 +240,7 @@ class Git : public SCM {
     }
     if (pc.outs().empty())
       KEXCEPT(Exception, "SCM ERROR URL OR BRANCH MAY NOT EXIST: " + url + " / " + b);
-    std::string s(mkn::kul::String::LINES(pc.outs())[0]);
+    std::string s(pc.line());
     mkn::kul::String::TRIM(s);
     return s.substr(0, s.find('\t'));
   }
@@ -202,6 +256,98 @@ class Git : public SCM {
     }
     return mkn::kul::String::LINES(pc.outs()).size() > 1;
   }
+
+  // for each directory one "git status", at most procs at once, 0 is one per hardware thread
+  scm::Batch<scm::Status> status_many(std::vector<std::string> const &dirs,
+                                      size_t const procs = 0) const {
+    scm::Batch<scm::Status> b(dirs.size());
+    std::vector<mkn::kul::Future<proc::Result>> fs;
+    fs.reserve(dirs.size());
+    proc::Scheduler s(procs);
+    for (auto const &d : dirs) {
+      mkn::kul::Process p("git", d);
+      p << "status"
+        << "--porcelain=v2"
+        << "--branch";
+      fs.emplace_back(s.submit(std::move(p)));
+    }
+    for (size_t i = 0; i < dirs.size(); i++) {
+      auto const r = result(fs[i], "SCM ERROR " + dirs[i], b.errors[i]);
+      if (!b.errors[i].empty()) continue;
+      auto &st = b.values[i];
+      each(r.out, [&](std::string_view const &l) {
+        if (l.rfind("# branch.oid ", 0) == 0)
+          st.version = std::string(l.substr(13));
+        else if (l.rfind("# branch.head ", 0) == 0)
+          st.branch = std::string(l.substr(14));
+        else if (!l.empty() && l[0] != '#')
+          st.changes = 1;
+      });
+    }
+    return b;
+  }
+
+  // remote versions of url/branch pairs, one "git ls-remote" per distinct url for all its branches
+  //  at most procs at once, 0 is one per hardware thread
+  scm::Batch<std::string> remoteVersion_many(
+      std::vector<std::pair<std::string, std::string>> const &refs, size_t const procs = 0) const {
+    scm::Batch<std::string> b(refs.size());
+    std::vector<std::string> urls;
+    std::vector<std::vector<size_t>> wants;  // inputs per url
+    hash::map::S2T<size_t> idx;
+    for (size_t i = 0; i < refs.size(); i++) {
+      if (!idx.count(refs[i].first)) {
+        idx.insert(refs[i].first, urls.size());
+        urls.emplace_back(refs[i].first);
+        wants.emplace_back();
+      }
+      wants[(*idx.find(refs[i].first)).second].push_back(i);
+    }
+
+    std::vector<mkn::kul::Future<proc::Result>> fs;
+    fs.reserve(urls.size());
+    proc::Scheduler s(procs);
+    for (size_t u = 0; u < urls.size(); u++) {
+      mkn::kul::Process p("git");
+      p << "ls-remote" << urls[u];
+      std::vector<std::string> bs;  // an empty branch wants HEAD, so every ref is listed
+      for (auto const i : wants[u]) bs.push_back(refs[i].second);
+      if (std::find(bs.begin(), bs.end(), "") == bs.end()) {
+        std::sort(bs.begin(), bs.end());
+        bs.erase(std::unique(bs.begin(), bs.end()), bs.end());
+        for (auto const &br : bs) p.arg(br);
+      }
+      fs.emplace_back(s.submit(std::move(p)));
+    }
+
+    for (size_t u = 0; u < urls.size(); u++) {
+      std::string error;
+      auto const r = result(fs[u], "SCM ERROR " + urls[u], error);
+      std::vector<std::pair<std::string_view, std::string_view>> ls;  // version, ref
+      each(r.out, [&](std::string_view const &l) {
+        auto const t = l.find('\t');
+        if (t != std::string_view::npos) ls.emplace_back(l.substr(0, t), l.substr(t + 1));
+      });
+      // as ls-remote patterns, the first ref equal to or ending in "/" + branch
+      for (auto const i : wants[u]) {
+        if (!error.empty()) {
+          b.errors[i] = error;
+          continue;
+        }
+        std::string const &br = refs[i].second, tail = "/" + br;
+        for (auto const &[version, ref] : ls)
+          if (br.empty() || ref == br ||
+              (ref.size() > tail.size() && ref.substr(ref.size() - tail.size()) == tail)) {
+            b.values[i] = std::string(version);
+            break;
+          }
+        if (b.values[i].empty())
+          b.errors[i] = "SCM ERROR URL OR BRANCH MAY NOT EXIST: " + urls[u] + " / " + br;
+      }
+    }
+    return b;
+  }
+
   void status(std::string const &d, bool full = 1) const override {
     mkn::kul::Process p("git", d);
     try {
@@ -0,0 +1,221 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef _MKN_KUL_TASK_HPP_
+#define _MKN_KUL_TASK_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef __MKN_KUL_TASK_CAPACITY__
+#define __MKN_KUL_TASK_CAPACITY__ 64
+#endif /*  __MKN_KUL_TASK_CAPACITY__ */
+
+namespace mkn {
+namespace kul {
+
+template <class F, size_t N = __MKN_KUL_TASK_CAPACITY__>
+class Task;
+
+// move only callable, stored inline if it fits in N bytes, otherwise on the heap
+template <class R, class... Args, size_t N>
+class Task<R(Args...), N> {
+ private:
+  enum class Op { MOVE, DESTROY };
+  using Invoke = R (*)(void *, Args &&...);
+  using Manage = void (*)(void *, void *, Op);
+
+  template <class Fn>
+  static constexpr bool INLINE = sizeof(Fn) <= N && alignof(Fn) <= alignof(std::max_align_t) &&
+                                 std::is_nothrow_move_constructible_v<Fn>;
+
+  template <class Fn>
+  static Fn &get(void *b) {
+    if constexpr (INLINE<Fn>)
+      return *std::launder(reinterpret_cast<Fn *>(b));
+    else
+      return **std::launder(reinterpret_cast<Fn **>(b));
+  }
+  template <class Fn>
+  static R invoke(void *b, Args &&... args) {
+    return std::invoke(get<Fn>(b), std::forward<Args>(args)...);
+  }
+  template <class Fn>
+  static void manage(void *dst, void *src, Op op) {
+    if constexpr (INLINE<Fn>) {
+      if (op == Op::MOVE) new (dst) Fn(std::move(get<Fn>(src)));
+      get<Fn>(src).~Fn();
+    } else {
+      if (op == Op::MOVE)
+        new (dst) Fn *(&get<Fn>(src));
+      else
+        delete &get<Fn>(src);
+    }
+  }
+
+  template <class Fn>
+  static bool empty(Fn const &f) {
+    if constexpr (std::is_pointer_v<Fn> || std::is_member_pointer_v<Fn>)
+      return f == nullptr;
+    else if constexpr (std::is_constructible_v<bool, Fn const &> && !std::is_class_v<Fn>)
+      return !f;
+    else
+      return false;
+  }
+  template <class S>
+  static bool empty(std::function<S> const &f) {
+    return !f;
+  }
+
+  alignas(std::max_align_t) unsigned char b[N];
+  Invoke i = nullptr;
+  Manage m = nullptr;
+
+  void reset() {
+    if (m) m(nullptr, b, Op::DESTROY);
+    i = nullptr;
+    m = nullptr;
+  }
+
+ public:
+  Task() {}
+  Task(std::nullptr_t) {}
+  template <class F, class Fn = std::decay_t<F>,
+            std::enable_if_t<!std::is_same_v<Fn, Task> && std::is_invocable_r_v<R, Fn &, Args...>,
+                             bool> = 0>
+  Task(F &&f) {
+    if (empty(f)) return;
+    if constexpr (INLINE<Fn>)
+      new (b) Fn(std::forward<F>(f));
+    else
+      new (b) Fn *(new Fn(std::forward<F>(f)));
+    i = &invoke<Fn>;
+    m = &manage<Fn>;
+  }
+  Task(Task &&t) noexcept : i(t.i), m(t.m) {
+    if (m) m(b, t.b, Op::MOVE);
+    t.i = nullptr;
+    t.m = nullptr;
+  }
+  Task(Task const &) = delete;
+  ~Task() { reset(); }
+
+  Task &operator=(Task &&t) noexcept {
+    if (this != &t) {
+      reset();
+      if (t.m) t.m(b, t.b, Op::MOVE);
+      i = t.i;
+      m = t.m;
+      t.i = nullptr;
+      t.m = nullptr;
+    }
+    return *this;
+  }
+  Task &operator=(Task const &) = delete;
+  Task &operator=(std::nullptr_t) {
+    reset();
+    return *this;
+  }
+
+  R operator()(Args... args) {
+    if (!i) throw std::bad_function_call();
+    return i(b, std::forward<Args>(args)...);
+  }
+  explicit operator bool() const { return i; }
+};
+
+namespace threading {
+
+// intrusive FIFO, popped nodes are kept for reuse so steady state push/pop does not allocate
+//  not thread safe
+template <class T>
+class TaskQueue {
+ private:
+  struct Node {
+    Node *next = nullptr;
+    T t;
+  };
+  Node *h = nullptr, *t = nullptr, *f = nullptr;
+  size_t s = 0;
+
+  static void clear(Node *n) {
+    while (n) {
+      Node *next = n->next;
+      delete n;
+      n = next;
+    }
+  }
+
+ public:
+  TaskQueue() {}
+  TaskQueue(TaskQueue const &) = delete;
+  TaskQueue &operator=(TaskQueue const &) = delete;
+  ~TaskQueue() {
+    clear(h);
+    clear(f);
+  }
+
+  void push(T &&v) {
+    Node *n = f;
+    if (n) {
+      f = n->next;
+      n->next = nullptr;
+      n->t = std::move(v);
+    } else
+      n = new Node{nullptr, std::move(v)};
+    if (t)
+      t->next = n;
+    else
+      h = n;
+    t = n;
+    s++;
+  }
+  T &front() { return h->t; }
+  void pop() {
+    Node *n = h;
+    h = h->next;
+    if (!h) t = nullptr;
+    n->t = T();
+    n->next = f;
+    f = n;
+    s--;
+  }
+  bool empty() const { return !h; }
+  size_t size() const { return s; }
+};
+
+}  // namespace threading
+}  // namespace kul
+}  // namespace mkn
+
+#endif /* _MKN_KUL_TASK_HPP_ */
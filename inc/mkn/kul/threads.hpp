@@ -31,8 +31,20 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _MKN_KUL_THREADS_HPP_
 #define _MKN_KUL_THREADS_HPP_
 
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+
+#include "mkn/kul/cpu.hpp"
+#include "mkn/kul/future.hpp"
 #include "mkn/kul/map.hpp"
+#include "mkn/kul/mpmc.hpp"
 #include "mkn/kul/os/threads.hpp"
+#include "mkn/kul/task.hpp"
+
+#ifndef __MKN_KUL_POOL_SPIN__
+#define __MKN_KUL_POOL_SPIN__ 64
+#endif /*  __MKN_KUL_POOL_SPIN__ */
 
 namespace mkn {
 namespace kul {
@@ -46,6 +58,68 @@ class ScopeLock {
   ~ScopeLock() { this->m.unlock(); }
 };
 
+namespace threading {
+
+// unbounded, the default backing queue of ConcurrentThreadQueue/Pool
+template <class T>
+class LockedQueue {
+ private:
+  TaskQueue<T> q;
+  mkn::kul::Mutex m;
+
+ public:
+  bool try_push(T &&t) {
+    mkn::kul::ScopeLock l(m);
+    q.push(std::move(t));
+    return true;
+  }
+  void push(T &&t) { try_push(std::move(t)); }
+  bool try_pop(T &t) {
+    mkn::kul::ScopeLock l(m);
+    if (q.empty()) return false;
+    t = std::move(q.front());
+    q.pop();
+    return true;
+  }
+  bool empty() {
+    mkn::kul::ScopeLock l(m);
+    return q.empty();
+  }
+};
+
+// backing queue selectors for ConcurrentThreadQueue/Pool
+// runs a Job once, cancelling it if discarded before being run
+class JobTask {
+ private:
+  Job *j;
+
+ public:
+  JobTask(Job *job) : j(job) {}
+  JobTask(JobTask &&t) noexcept : j(t.j) { t.j = nullptr; }
+  JobTask(JobTask const &) = delete;
+  ~JobTask() {
+    if (j) j->cancel();
+  }
+  void operator()() {
+    Job *job = j;
+    j = nullptr;
+    job->run();
+    job->release();
+  }
+};
+
+struct Locked {
+  template <class T>
+  using queue = LockedQueue<T>;
+};
+template <size_t N = 1024>
+struct LockFree {
+  template <class T>
+  using queue = MPMCQueue<T, N>;
+};
+
+}  // namespace threading
+
 class ThreadQueue {
  protected:
   bool d = 0, f = 0, s = 0;
@@ -151,22 +225,28 @@ class PredicatedThreadQueue : public ThreadQueue {
       : ThreadQueue(ref), p(pr), ps(p.size()) {}
 };
 
-template <class F, class E = mkn::kul::Exception>
+template <class F, class E = mkn::kul::Exception, class Q = threading::Locked>
 class ConcurrentThreadQueue {
   friend class mkn::kul::Thread;
 
  protected:
-  size_t _cur = 0, _max = 1;
+  struct Item {
+    Task<F> f;
+    Task<void(const E &)> e;
+  };
+
+  size_t _cur = 0, _max = 1, _n = 0;
   const uint64_t m_nWait;
   std::atomic<bool> _block, _detatched, _up;
-  std::queue<std::unique_ptr<std::pair<std::function<F>, std::function<void(const E &)>>>> _q;
+  typename Q::template queue<Item> _q;
   mkn::kul::hash::map::S2T<std::shared_ptr<mkn::kul::Thread>> _k;
-  mkn::kul::hash::map::S2T<std::function<void(const E &)>> _e;
+  std::unordered_map<std::string, Task<F>> _f;
+  std::unordered_map<std::string, Task<void(const E &)>> _e;
 
   mkn::kul::Thread _thread;
   mkn::kul::Mutex _mmutex, _qmutex;
 
-  void _KTHROW(const std::exception_ptr &ep, const std::function<void(const E &)> &func) {
+  void _KTHROW(const std::exception_ptr &ep, Task<void(const E &)> &func) {
     try {
       std::rethrow_exception(ep);
     } catch (const E &e) {
@@ -176,22 +256,16 @@ class ConcurrentThreadQueue {
   virtual void operator()() {
     while (_up) {
       this_thread::nSleep(m_nWait);
-      {
-        mkn::kul::ScopeLock l(_qmutex);
-        if (_q.empty()) continue;
-      }
+      if (_q.empty()) continue;
 
       for (; _cur < _max; _cur++) {
-        mkn::kul::ScopeLock l(_qmutex);
-        auto &f_ptr(_q.front());
-        auto &f(*f_ptr.get());
-        std::stringstream ss;
-        ss << &f;
-        auto k(ss.str());
-        _k.insert(k, std::make_shared<mkn::kul::Thread>(f.first));
-        _e.insert(k, f.second);
+        Item f;
+        if (!_q.try_pop(f)) break;
+        auto k(std::to_string(_n++));
+        auto *t = &(_f[k] = std::move(f.f));
+        _k.insert(k, std::make_shared<mkn::kul::Thread>([t]() { (*t)(); }));
+        _e[k] = std::move(f.e);
         _k[k]->run();
-        _q.pop();
       }
 
       mkn::kul::hash::set::String del;
@@ -199,8 +273,9 @@ class ConcurrentThreadQueue {
         if (t.second->finished()) {
           t.second->join();
           if (t.second->exception() != std::exception_ptr()) {
-            if (_e.count(t.first))
-              _KTHROW(t.second->exception(), _e[t.first]);
+            auto e = _e.find(t.first);
+            if (e != _e.end() && e->second)
+              _KTHROW(t.second->exception(), e->second);
             else if (!_detatched)
               std::rethrow_exception(t.second->exception());
           }
@@ -208,7 +283,11 @@ class ConcurrentThreadQueue {
           _cur--;
         }
       }
-      for (const auto &s : del) _k.erase(s) && _e.erase(s);
+      for (const auto &s : del) {
+        _k.erase(s);
+        _f.erase(s);
+        _e.erase(s);
+      }
     }
   }
 
@@ -221,7 +300,6 @@ class ConcurrentThreadQueue {
   ConcurrentThreadQueue(const size_t &max = 1, bool strt = 0, const uint64_t &nWait = 1000000)
       : _max(max), m_nWait(nWait), _block(0), _detatched(0), _up(0), _thread(std::ref(*this)) {
     _k.setDeletedKey("");
-    _e.setDeletedKey("");
     if (strt) ConcurrentThreadQueue::start();
   }
   virtual ~ConcurrentThreadQueue() {}
@@ -246,10 +324,7 @@ class ConcurrentThreadQueue {
   virtual ConcurrentThreadQueue &finish(const uint64_t &nWait = 1000000) KTHROW(mkn::kul::Exception) {
     while (_up) {
       this_thread::nSleep(nWait);
-      {
-        mkn::kul::ScopeLock l(_qmutex);
-        if (_q.empty()) stop();
-      }
+      if (_q.empty()) stop();
     }
     return *this;
   }
@@ -269,18 +344,15 @@ class ConcurrentThreadQueue {
     return *this;
   }
 
-  bool async(std::function<F> &&function,
-             std::function<void(const E &)> &&exception = std::function<void(const E &)>()) {
+  // blocks while a bounded queue is full
+  bool async(Task<F> &&function, Task<void(const E &)> &&exception = nullptr) {
     if (_block) return false;
-    {
-      auto pair = std::unique_ptr<std::pair<std::function<F>, std::function<void(const E &)>>>(
-          new std::pair<std::function<F>, std::function<void(const E &)>>(function, exception));
-      mkn::kul::ScopeLock l(_qmutex);
-      _q.push(std::move(pair));
-    }
+    _q.push(Item{std::move(function), std::move(exception)});
     return true;
   }
 
+  size_t size() const { return _max; }
+
    std::exception_ptr const& exception() const { return _thread.exception(); }
 
   void rethrow() {
@@ -288,22 +360,23 @@ class ConcurrentThreadQueue {
   }
 };
 
-template <class E, class PT>
+template <class E, class PT, class Q>
 class ConcurrentThreadPool;
 
 class PoolThread {
-  template <class E, class PT>
+  template <class E, class PT, class Q>
   friend class ConcurrentThreadPool;
 
  protected:
   const uint64_t m_nWait;
   std::atomic<bool> m_ready, m_run;
-  std::function<void()> m_function;
+  Task<void()> m_function;
   mkn::kul::Mutex _mutex;
 
-  bool if_ready_set(const std::function<void()> &f) {
+  // f is only moved from if this thread is ready
+  bool if_ready_set(Task<void()> &f) {
     if (!m_ready) return false;
-    m_function = f;
+    m_function = std::move(f);
     m_ready = 0;
     return true;
   }
@@ -317,7 +390,7 @@ class PoolThread {
   virtual bool operate() {
     if (m_ready) return false;
     m_function();
-    m_function = 0;
+    m_function = nullptr;
     m_ready = 1;
     return true;
   }
@@ -333,27 +406,48 @@ class PoolThread {
   }
 };
 
-template <class E = mkn::kul::Exception, class PT = mkn::kul::PoolThread>
-class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
+template <class E = mkn::kul::Exception, class PT = mkn::kul::PoolThread,
+          class Q = threading::Locked>
+class ConcurrentThreadPool : public ConcurrentThreadQueue<void(), mkn::kul::Exception, Q>,
+                             public threading::Executor {
  protected:
+  using Queue = ConcurrentThreadQueue<void(), mkn::kul::Exception, Q>;
+  using typename Queue::Item;
+  using Queue::_block, Queue::_detatched, Queue::_e, Queue::_k, Queue::_max, Queue::_mmutex,
+      Queue::_q, Queue::_qmutex, Queue::_thread, Queue::_up, Queue::m_nWait, Queue::_KTHROW;
+
   mkn::kul::hash::map::S2T<std::shared_ptr<PT>> _p;
+  std::vector<std::vector<uint32_t>> _cpus;
+  Item _next;  // popped but not yet taken by a PoolThread
+
+  // drops work never taken by a PoolThread, submitted jobs are cancelled which may queue more
+  void discard() {
+    Item i;
+    while (true) {
+      {
+        mkn::kul::ScopeLock l(_qmutex);
+        if (_next.f)
+          i = std::move(_next);
+        else if (!_q.try_pop(i))
+          break;
+      }
+      i = Item{};
+    }
+  }
 
   virtual bool operate() {
     bool qEmpty = 0;
     {
       mkn::kul::ScopeLock l(_qmutex);
-      qEmpty = _q.empty();
+      qEmpty = !_next.f && _q.empty();
     }
     if (!qEmpty) {
       mkn::kul::ScopeLock l(_qmutex);
       for (size_t i = 0; i < _max; i++) {
+        if (!_next.f && !_q.try_pop(_next)) break;
         const auto n = std::to_string(i);
-        auto &f_ptr(_q.front());
-        auto &f(*f_ptr.get());
-        if (!_p[n]->if_ready_set(f.first)) continue;
-        _e[n] = f.second;
-        _q.pop();
-        if (_q.empty()) break;
+        if (!_p[n]->if_ready_set(_next.f)) continue;
+        _e[n] = std::move(_next.e);
       }
     }
 
@@ -364,8 +458,9 @@ class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
       for (const auto &t : _k) {
         if (t.second->started() && t.second->finished()) {
           if (t.second->exception() != std::exception_ptr()) {
-            if (_e.count(t.first))
-              _KTHROW(t.second->exception(), _e[t.first]);
+            auto e = _e.find(t.first);
+            if (e != _e.end() && e->second)
+              _KTHROW(t.second->exception(), e->second);
             else if (!_detatched)
               std::rethrow_exception(t.second->exception());
             del.push_back(t.first);
@@ -384,6 +479,7 @@ class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
         _p.erase(n);
         _p.insert(n, std::make_shared<PT>());
         _k.insert(n, std::make_shared<mkn::kul::Thread>(std::ref(*_p[n].get())));
+        _k[n]->affinity(_cpus[std::stoul(n)]);
         _k[n]->run();
       }
     }
@@ -402,12 +498,16 @@ class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
   ConcurrentThreadPool &operator=(const ConcurrentThreadPool &&) = delete;
 
  public:
-  ConcurrentThreadPool(const size_t &max = 1, bool strt = 0, const uint64_t &nWait = 1000000)
-      : ConcurrentThreadQueue(max, 0, nWait) {
+  using Queue::async;
+
+  ConcurrentThreadPool(const size_t &max = 1, bool strt = 0, const uint64_t &nWait = 1000000,
+                       cpu::Placement const &placement = cpu::Placement::NONE)
+      : Queue(max, 0, nWait), _cpus(cpu::place(placement, max)) {
     for (size_t i = 0; i < max; i++) {
       auto n = std::to_string(i);
       _p.insert(n, std::make_shared<PT>());
       _k.insert(n, std::make_shared<mkn::kul::Thread>(std::ref(*_p[n].get())));
+      _k[n]->affinity(_cpus[i]);
     }
     _p.setDeletedKey("");
     if (strt) start();
@@ -415,6 +515,8 @@ class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
   virtual ~ConcurrentThreadPool() {
     stop();
     join();
+    for (auto &p : _p) p.second->m_function = nullptr;
+    discard();
   }
   virtual ConcurrentThreadPool &start() override {
     if (!_up) {
@@ -426,8 +528,11 @@ class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
   }
   virtual ConcurrentThreadPool &stop() override {
     _up = 0;
-    mkn::kul::ScopeLock l(_mmutex);
-    for (auto &t : _p) t.second->stop();
+    {
+      mkn::kul::ScopeLock l(_mmutex);
+      for (auto &t : _p) t.second->stop();
+    }
+    discard();
     return *this;
   }
   virtual ConcurrentThreadPool &finish(const uint64_t &nWait = 1000000)
@@ -437,7 +542,7 @@ class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
       {
         mkn::kul::ScopeLock l1(_qmutex);
         mkn::kul::ScopeLock l2(_mmutex);
-        if (_q.empty()) {
+        if (!_next.f && _q.empty()) {
           size_t i;
           for (i = 0; i < _max; i++)
             if (!_p[std::to_string(i)]->ready()) break;
@@ -471,6 +576,24 @@ class ConcurrentThreadPool : public ConcurrentThreadQueue<void()> {
     }
     return *this;
   }
+
+  // continuations of work already submitted, queued even once blocked
+  void execute(threading::Job *job) override {
+    _q.push(Item{threading::JobTask(job), nullptr});
+  }
+
+  template <class F, class... Args>
+  auto submit(F &&f, Args &&... args) {
+    using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+    auto *job = new threading::FutureJob<R, std::decay_t<F>, std::decay_t<Args>...>(
+        this, std::forward<F>(f), std::forward<Args>(args)...);
+    Future<R> fut(job);
+    if (_block)
+      job->cancel();
+    else
+      execute(job);
+    return fut;
+  }
 };
 
 class AutoChronPoolThread : public PoolThread {
@@ -495,9 +618,12 @@ class AutoChronPoolThread : public PoolThread {
   }
 };
 
-template <class E = mkn::kul::Exception>
-class ChroncurrentThreadPool : public ConcurrentThreadPool<void(), AutoChronPoolThread> {
+template <class E = mkn::kul::Exception, class Q = threading::Locked>
+class ChroncurrentThreadPool : public ConcurrentThreadPool<void(), AutoChronPoolThread, Q> {
  protected:
+  using Pool = ConcurrentThreadPool<void(), AutoChronPoolThread, Q>;
+  using Pool::_up, Pool::m_nWait, Pool::operate, Pool::start;
+
   uint64_t m_scale = 0;
 
   ChroncurrentThreadPool(const ChroncurrentThreadPool &) = delete;
@@ -507,8 +633,9 @@ class ChroncurrentThreadPool : public ConcurrentThreadPool<void(), AutoChronPool
 
  public:
   ChroncurrentThreadPool(const size_t &max = 1, bool strt = 0, const uint64_t &nWait = 1000000,
-                         const uint64_t &scale = 1000)
-      : ConcurrentThreadPool(max, 0, nWait), m_scale(scale) {
+                         const uint64_t &scale = 1000,
+                         cpu::Placement const &placement = cpu::Placement::NONE)
+      : Pool(max, 0, nWait, placement), m_scale(scale) {
     if (m_scale > nWait) KEXCEPTION("Time scale cannot be larger than wait period");
     if (strt) start();
   }
@@ -525,6 +652,387 @@ class ChroncurrentThreadPool : public ConcurrentThreadPool<void(), AutoChronPool
   }
 };
 
+namespace threading {
+
+// Chase-Lev work stealing deque, owner pushes/pops at the bottom, thieves steal from the top
+//  see "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013)
+template <class T>
+class StealDeque {
+ private:
+  struct Array {
+    Array(int64_t const &_size) : size(_size), mask(_size - 1), buf(new std::atomic<T *>[_size]) {}
+    T *get(int64_t const &i) const { return buf[i & mask].load(std::memory_order_relaxed); }
+    void put(int64_t const &i, T *t) { buf[i & mask].store(t, std::memory_order_relaxed); }
+    Array *grow(int64_t const &b, int64_t const &t) const {
+      auto *a = new Array(size * 2);
+      for (int64_t i = t; i < b; i++) a->put(i, get(i));
+      return a;
+    }
+    int64_t const size, mask;
+    std::unique_ptr<std::atomic<T *>[]> buf;
+  };
+
+  alignas(64) std::atomic<int64_t> _top;
+  alignas(64) std::atomic<int64_t> _bottom;
+  std::atomic<Array *> _array;
+  std::vector<std::unique_ptr<Array>> _old;  // retired arrays may still be read by thieves
+
+  StealDeque(StealDeque const &) = delete;
+  StealDeque &operator=(StealDeque const &) = delete;
+
+ public:
+  StealDeque(int64_t const &size = 256) : _top(0), _bottom(0), _array(new Array(size)) {}
+  ~StealDeque() { delete _array.load(); }
+
+  // owner only
+  void push(T *t) {
+    int64_t b = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_acquire);
+    Array *a = _array.load(std::memory_order_relaxed);
+    if (b - top > a->size - 1) {
+      _old.emplace_back(a);
+      a = a->grow(b, top);
+      _array.store(a, std::memory_order_release);
+    }
+    a->put(b, t);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // owner only
+  T *pop() {
+    int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+    Array *a = _array.load(std::memory_order_relaxed);
+    _bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = _top.load(std::memory_order_relaxed);
+    T *x = nullptr;
+    if (t <= b) {
+      x = a->get(b);
+      if (t == b) {
+        if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+          x = nullptr;
+        _bottom.store(b + 1, std::memory_order_relaxed);
+      }
+    } else
+      _bottom.store(b + 1, std::memory_order_relaxed);
+    return x;
+  }
+
+  // any thread
+  T *steal() {
+    int64_t t = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = _bottom.load(std::memory_order_acquire);
+    if (t < b) {
+      T *x = _array.load(std::memory_order_acquire)->get(t);
+      if (_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+        return x;
+    }
+    return nullptr;
+  }
+
+  bool empty() const {
+    return _bottom.load(std::memory_order_relaxed) <= _top.load(std::memory_order_relaxed);
+  }
+};
+
+}  // namespace threading
+
+template <class E = mkn::kul::Exception>
+class WorkStealingPool : public threading::Executor {
+ protected:
+  using Job = threading::Job;
+
+  // recycled via release() so async does not allocate once the pool is warm
+  class Async : public Job {
+   public:
+    Async(WorkStealingPool &_p) : p(_p) {}
+    void run() override {
+      try {
+        f();
+      } catch (E const &ex) {
+        if (!e) throw;
+        e(ex);
+      }
+    }
+    void release() override {
+      f = nullptr;
+      e = nullptr;
+      p.recycle(this);
+    }
+
+    Task<void()> f;
+    Task<void(E const &)> e;
+
+   private:
+    WorkStealingPool &p;
+  };
+
+  struct Worker {
+    Worker(WorkStealingPool &pool, size_t const &_i)
+        : i(_i), seed(_i * 0x9E3779B97F4A7C15ull + 1), thread([&pool, _i]() { pool.work(_i); }) {}
+    size_t const i;
+    uint64_t seed;
+    threading::StealDeque<Job> deque;
+    Async *free = nullptr;
+    size_t nfree = 0;
+    mkn::kul::Thread thread;
+  };
+
+  static constexpr size_t CACHE = 256;  // per worker free Async limit, excess goes to _free
+
+  size_t const _max;
+  std::atomic<bool> _block, _detatched, _up;
+  std::atomic<size_t> _queued, _pending, _idle;
+  std::vector<std::unique_ptr<Worker>> _w;
+  Job *_head = nullptr, *_tail = nullptr;  // injection queue linked through Job::next
+  Async *_free = nullptr;
+  std::exception_ptr _ep;
+  mkn::kul::Mutex _qmutex, _emutex;
+  std::mutex _pmutex;
+  std::condition_variable _park, _done;
+
+  static std::pair<WorkStealingPool *, size_t> &CURRENT() {
+    static thread_local std::pair<WorkStealingPool *, size_t> c{nullptr, 0};
+    return c;
+  }
+
+  void push(Job *job) {
+    _pending++;
+    _queued++;
+    auto &c(CURRENT());
+    if (c.first == this)
+      _w[c.second]->deque.push(job);
+    else {
+      mkn::kul::ScopeLock l(_qmutex);
+      job->next = nullptr;
+      (_tail ? _tail->next : _head) = job;
+      _tail = job;
+    }
+    if (_idle) {
+      { std::lock_guard<std::mutex> l(_pmutex); }
+      _park.notify_one();
+    }
+  }
+
+  Async *make(Task<void()> &&f, Task<void(E const &)> &&e) {
+    Async *a = nullptr;
+    auto &c(CURRENT());
+    if (c.first == this && _w[c.second]->free) {
+      auto &w(*_w[c.second]);
+      a = w.free;
+      w.free = static_cast<Async *>(a->next);
+      w.nfree--;
+    } else {
+      mkn::kul::ScopeLock l(_qmutex);
+      if (_free) {
+        a = _free;
+        _free = static_cast<Async *>(a->next);
+      }
+    }
+    if (!a) a = new Async(*this);
+    a->next = nullptr;
+    a->f = std::move(f);
+    a->e = std::move(e);
+    return a;
+  }
+  void recycle(Async *a) {
+    auto &c(CURRENT());
+    if (c.first == this && _w[c.second]->nfree < CACHE) {
+      auto &w(*_w[c.second]);
+      a->next = w.free;
+      w.free = a;
+      w.nfree++;
+      return;
+    }
+    mkn::kul::ScopeLock l(_qmutex);
+    a->next = _free;
+    _free = a;
+  }
+  static void clear(Async *a) {
+    while (a) {
+      auto *n = static_cast<Async *>(a->next);
+      delete a;
+      a = n;
+    }
+  }
+
+  Job *take(Worker &w) {
+    Job *job = w.deque.pop();
+    if (!job) {
+      mkn::kul::ScopeLock l(_qmutex);
+      if ((job = _head)) {
+        _head = job->next;
+        if (!_head) _tail = nullptr;
+        job->next = nullptr;
+      }
+    }
+    for (size_t i = 0; !job && i < _w.size(); i++) {
+      w.seed ^= w.seed << 13, w.seed ^= w.seed >> 7, w.seed ^= w.seed << 17;
+      auto &v(*_w[(w.seed + i) % _w.size()]);
+      if (&v != &w) job = v.deque.steal();
+    }
+    if (job) _queued--;
+    return job;
+  }
+
+  void run(Job *job) {
+    try {
+      job->run();
+    } catch (...) {
+      except(std::current_exception());
+    }
+    job->release();
+    if (--_pending == 0) {
+      { std::lock_guard<std::mutex> l(_pmutex); }
+      _done.notify_all();
+    }
+  }
+
+  void except(std::exception_ptr const &ep) {
+    mkn::kul::ScopeLock l(_emutex);
+    if (!_ep) _ep = ep;
+  }
+
+  void work(size_t const &i) {
+    CURRENT() = {this, i};
+    auto &w(*_w[i]);
+    while (_up) {
+      Job *job = take(w);
+      for (size_t s = 0; !job && _up && s < __MKN_KUL_POOL_SPIN__; s++) {
+        std::this_thread::yield();
+        if (_queued) job = take(w);
+      }
+      if (job) {
+        run(job);
+        continue;
+      }
+      std::unique_lock<std::mutex> l(_pmutex);
+      _idle++;
+      _park.wait(l, [&]() { return _queued > 0 || !_up; });
+      _idle--;
+    }
+    CURRENT() = {nullptr, 0};
+  }
+
+  void wake() {
+    { std::lock_guard<std::mutex> l(_pmutex); }
+    _park.notify_all();
+    _done.notify_all();
+  }
+
+  WorkStealingPool(WorkStealingPool const &) = delete;
+  WorkStealingPool(WorkStealingPool &&) = delete;
+  WorkStealingPool &operator=(WorkStealingPool const &) = delete;
+  WorkStealingPool &operator=(WorkStealingPool &&) = delete;
+
+ public:
+  WorkStealingPool(size_t const &max = 1, bool strt = 0,
+                   cpu::Placement const &placement = cpu::Placement::NONE)
+      : _max(max ? max : 1), _block(0), _detatched(0), _up(0), _queued(0), _pending(0), _idle(0) {
+    for (size_t i = 0; i < _max; i++) _w.emplace_back(std::make_unique<Worker>(*this, i));
+    auto const cpus(cpu::place(placement, _max));
+    for (size_t i = 0; i < _max; i++) _w[i]->thread.affinity(cpus[i]);
+    if (strt) start();
+  }
+  virtual ~WorkStealingPool() {
+    stop();
+    if (!_detatched) join();
+    while (auto *job = _head) {
+      _head = job->next;
+      job->next = nullptr;
+      job->cancel();
+    }
+    for (auto &w : _w)
+      while (auto *job = w->deque.pop()) job->cancel();
+    for (auto &w : _w) clear(w->free);
+    clear(_free);
+  }
+
+  WorkStealingPool &start() {
+    if (!_up) {
+      _up = 1;
+      for (auto &w : _w) w->thread.run();
+    }
+    return *this;
+  }
+  WorkStealingPool &stop() {
+    _up = 0;
+    wake();
+    return *this;
+  }
+  WorkStealingPool &finish() KTHROW(mkn::kul::Exception) {
+    {
+      std::unique_lock<std::mutex> l(_pmutex);
+      _done.wait(l, [&]() { return _pending == 0 || !_up; });
+    }
+    return stop();
+  }
+  WorkStealingPool &join() {
+    for (auto &w : _w)
+      if (w->thread.started()) w->thread.join();
+    return *this;
+  }
+  WorkStealingPool &detach() {
+    if (_up) {
+      _detatched = 1;
+      for (auto &w : _w) w->thread.detach();
+    }
+    return *this;
+  }
+  WorkStealingPool &interrupt() {
+    for (auto &w : _w) w->thread.interrupt();
+    return *this;
+  }
+  WorkStealingPool &block() {
+    _block = 1;
+    return *this;
+  }
+  WorkStealingPool &unblock() {
+    _block = 0;
+    return *this;
+  }
+
+  bool async(Task<void()> &&function, Task<void(E const &)> &&exception = nullptr) {
+    if (_block) return false;
+    push(make(std::move(function), std::move(exception)));
+    return true;
+  }
+
+  template <class F, class... Args>
+  auto submit(F &&f, Args &&... args) {
+    using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+    auto *job = new threading::FutureJob<R, std::decay_t<F>, std::decay_t<Args>...>(
+        this, std::forward<F>(f), std::forward<Args>(args)...);
+    Future<R> fut(job);
+    if (_block)
+      job->cancel();
+    else
+      push(job);
+    return fut;
+  }
+
+  void execute(Job *job) override { push(job); }
+  bool helps() const override { return CURRENT().first == this; }
+  bool help() override {
+    if (!helps()) return false;
+    Job *job = take(*_w[CURRENT().second]);
+    if (job) run(job);
+    return job;
+  }
+
+  size_t size() const { return _max; }
+
+  std::exception_ptr const &exception() const { return _ep; }
+
+  void rethrow() {
+    if (_ep) std::rethrow_exception(_ep);
+  }
+};
+
 }  // namespace kul
 }  // namespace mkn
 
@@ -96,6 +96,21 @@ class DateTime {
   static const std::string NOW(std::string const &f = "%Y-%m-%d-%H:%M:%S") {
     return AS(std::time(NULL), f);
   }
+  // nanoseconds since epoch, %i being its milliseconds
+  static const std::string AT(uint64_t const &nanos, std::string f = "%Y-%m-%d-%H:%M:%S") {
+    auto const ms = std::to_string(1000 + (nanos / 1000000) % 1000);
+    mkn::kul::String::REPLACE(f, "%i", ms.substr(1));
+    std::time_t const t = nanos / 1000000000;
+    char buffer[80];
+    struct tm ti;
+#ifdef _WIN32
+    localtime_s(&ti, &t);
+#else
+    localtime_r(&t, &ti);
+#endif
+    std::strftime(buffer, 80, f.c_str(), &ti);
+    return std::string(buffer);
+  }
 };
 }  // namespace kul
 }  // namespace mkn
@@ -30,16 +30,56 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "mkn/kul/cli.hpp"
+#include "mkn/kul/fs/walk.hpp"
+#include "mkn/kul/hash.hpp"
+#include "mkn/kul/io.hpp"
+#include "mkn/kul/io/uring.hpp"
 #include "mkn/kul/log.hpp"
 #include "mkn/kul/os.hpp"
+#include "mkn/kul/parallel.hpp"
+#include "mkn/kul/proc.hpp"
+#include "mkn/kul/proc/scheduler.hpp"
+#include "mkn/kul/proc/worker.hpp"
 #include "mkn/kul/threads.hpp"
 
+#include <cstdlib>
+#include <new>
+
 #if __has_include("benchmark/benchmark.h")
 #include "benchmark/benchmark.h"
 #else
 #include "benchmark/benchmark_api.h"
 #endif
 
+// counts allocations, every form of new and delete is replaced so they stay paired
+//  g++ inlines these and then reports malloc/free as mismatched with new/delete
+std::atomic<size_t> allocs{0};
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void *alloc(size_t n, size_t a = 0) {
+  allocs++;
+  if (void *p = a ? std::aligned_alloc(a, (n + a - 1) / a * a) : std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void *operator new(size_t n) { return alloc(n); }
+void *operator new[](size_t n) { return alloc(n); }
+void *operator new(size_t n, std::align_val_t a) { return alloc(n, size_t(a)); }
+void *operator new[](size_t n, std::align_val_t a) { return alloc(n, size_t(a)); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
 void createDeleteFile(benchmark::State &state) {
   while (state.KeepRunning()) {
     mkn::kul::File f("tmp.tmp");
@@ -104,7 +144,342 @@ void chroncurrentThreadPool(benchmark::State &state) {
 }
 BENCHMARK(chroncurrentThreadPool)->Unit(benchmark::kMicrosecond);
 
+void workStealingPool(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    mkn::kul::WorkStealingPool<> wsp(3, 1);
+    for (size_t i = 0; i < 10000; i++) wsp.async(std::bind(lambda, 2, 4));
+    wsp.block().finish().join();
+  }
+}
+BENCHMARK(workStealingPool)->Unit(benchmark::kMicrosecond);
+
+void parallelReduce(benchmark::State &state) {
+  mkn::kul::WorkStealingPool<> wsp(3, 1);
+  std::vector<double> v(1 << 20, 1);
+  auto sum = [](double a, double b) { return a + b; };
+  while (state.KeepRunning()) benchmark::DoNotOptimize(mkn::kul::parallel_reduce(wsp, v, 0.0, sum));
+  wsp.finish().join();
+}
+BENCHMARK(parallelReduce)->Unit(benchmark::kMicrosecond);
+
+template <class Queue>
+void queueContention(benchmark::State &state) {
+  static Queue q;
+  size_t v = 0;
+  while (state.KeepRunning()) {
+    q.push(size_t(1));
+    q.try_pop(v);
+  }
+}
+BENCHMARK_TEMPLATE(queueContention, mkn::kul::threading::LockedQueue<size_t>)->Threads(4);
+BENCHMARK_TEMPLATE(queueContention, mkn::kul::MPMCQueue<size_t, 1024>)->Threads(4);
+
+// heap allocations per task once the pool is warm, tasks fit the inline Task buffer
+template <class Pool>
+void allocationsPerTask(benchmark::State &state, Pool &pool, size_t const n) {
+  std::atomic<size_t> done{0};
+  size_t tasks = 0, count = 0;
+  auto batch = [&]() {
+    for (size_t i = 0; i < n; i++) pool.async([&done]() { done++; });
+    tasks += n;
+    while (done < tasks) mkn::kul::this_thread::uSleep(10);
+  };
+  batch();
+  while (state.KeepRunning()) {
+    auto before = allocs.load();
+    batch();
+    count += allocs.load() - before;
+  }
+  state.counters["allocs/task"] = double(count) / double(tasks - n);
+  pool.block().finish().join();
+}
+
+void workStealingPoolAllocations(benchmark::State &state) {
+  mkn::kul::WorkStealingPool<> wsp(3, 1);
+  allocationsPerTask(state, wsp, 10000);
+}
+BENCHMARK(workStealingPoolAllocations)->Unit(benchmark::kMicrosecond);
+
+void concurrentThreadPoolAllocations(benchmark::State &state) {
+  mkn::kul::ConcurrentThreadPool<> ctp(3, 1);
+  allocationsPerTask(state, ctp, 100);
+}
+BENCHMARK(concurrentThreadPoolAllocations)->Unit(benchmark::kMicrosecond);
+
+// default format, the per message REPLACE passes logging used before formats were compiled
+void logFormatReplace(benchmark::State &state) {
+  std::string const msg("message");
+  while (state.KeepRunning()) {
+    std::string st(__MKN_KUL_LOG_FRMT__);
+    mkn::kul::String::REPLACE(st, "%M", "INF");
+    mkn::kul::String::REPLACE(st, "%T", mkn::kul::this_thread::id());
+    mkn::kul::String::REPLACE(st, "%D", mkn::kul::DateTime::NOW(__MKN_KUL_LOG_TIME_FRMT__));
+    mkn::kul::String::REPLACE(st, "%F", __FILE__);
+    mkn::kul::String::REPLACE(st, "%N", __func__);
+    mkn::kul::String::REPLACE(st, "%L", std::to_string(__LINE__));
+    mkn::kul::String::REPLACE(st, "%S", msg);
+    benchmark::DoNotOptimize(st + mkn::kul::os::EOL());
+  }
+}
+BENCHMARK(logFormatReplace)->Unit(benchmark::kNanosecond);
+
+void logFormatCompiled(benchmark::State &state) {
+  mkn::kul::Logger logger;
+  logger.setOut([](std::string const &s) { benchmark::DoNotOptimize(s.data()); });
+  std::string const msg("message");
+  while (state.KeepRunning())
+    logger.log(__FILE__, __func__, __LINE__, msg, mkn::kul::log::mode::INF);
+}
+BENCHMARK(logFormatCompiled)->Unit(benchmark::kNanosecond);
+
+void logDisabled(benchmark::State &state) {
+  mkn::kul::LogMan::INSTANCE().setMode(mkn::kul::log::mode::NON);
+  std::string const msg("message");
+  while (state.KeepRunning()) KLOG(INF) << msg << state.iterations();
+}
+BENCHMARK(logDisabled)->Unit(benchmark::kNanosecond);
+
+// ~64MB of lines between 0 and 150 characters
+mkn::kul::File const &lineFile() {
+  static mkn::kul::File f("lines.tmp");
+  static bool made = 0;
+  if (!made) {
+    std::string s;
+    size_t n = 0;
+    while (s.size() < (size_t(64) << 20))
+      s.append((n = (n * 7919 + 13) % 151), 'x').append(1, '\n');
+    mkn::kul::io::Writer(f).write(s.c_str(), s.size());
+    made = 1;
+  }
+  return f;
+}
+
+void readLineReader(benchmark::State &state) {
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    mkn::kul::io::Reader r(lineFile());
+    while (char const *c = r.readLine()) bytes += strlen(c) + 1;
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(readLineReader)->Unit(benchmark::kMillisecond);
+
+void readLineMapped(benchmark::State &state) {
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    mkn::kul::io::MappedReader r(lineFile());
+    for (auto const &l : r.lines()) bytes += l.size() + 1;
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(readLineMapped)->Unit(benchmark::kMillisecond);
+
+// 10M short lines
+void writeLinesWriter(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    mkn::kul::io::Writer w("writer.tmp");
+    for (size_t i = 0; i < 10000000; i++) w.write("a short line", true);
+  }
+  mkn::kul::File("writer.tmp").rm();
+}
+BENCHMARK(writeLinesWriter)->Unit(benchmark::kMillisecond);
+
+template <bool async>
+void writeLinesBuffered(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    mkn::kul::io::BufferedWriter w("writer.tmp", 4 << 20, async);
+    for (size_t i = 0; i < 10000000; i++) w.line("a short line");
+  }
+  mkn::kul::File("writer.tmp").rm();
+}
+BENCHMARK_TEMPLATE(writeLinesBuffered, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(writeLinesBuffered, true)->Unit(benchmark::kMillisecond);
+
+// 2000 files of 4KB
+std::vector<mkn::kul::File> const &smallFiles() {
+  static mkn::kul::Dir d("small.tmp");
+  static std::vector<mkn::kul::File> fs;
+  if (fs.empty()) {
+    d.mk();
+    std::string const s(4096, 'x');
+    for (size_t i = 0; i < 2000; i++) {
+      fs.emplace_back(std::to_string(i), d);
+      mkn::kul::io::Writer(fs.back()) << s;
+    }
+  }
+  return fs;
+}
+
+void readSmallFilesReader(benchmark::State &state) {
+  size_t bytes = 0;
+  while (state.KeepRunning())
+    for (auto const &f : smallFiles()) {
+      mkn::kul::io::BinaryReader r(f);
+      char c[4096];
+      bytes += r.read(c, sizeof(c));
+    }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(readSmallFilesReader)->Unit(benchmark::kMillisecond);
+
+template <bool native>
+void readSmallFilesEngine(benchmark::State &state) {
+  std::atomic<size_t> bytes{0};
+  mkn::kul::io::uring::Engine e(256, 0, native);
+  while (state.KeepRunning()) {
+    e.read(smallFiles(), [&](mkn::kul::io::uring::Result &&r) { bytes += r.data.size(); });
+    e.wait();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_TEMPLATE(readSmallFilesEngine, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(readSmallFilesEngine, false)->Unit(benchmark::kMillisecond);
+
+// 20 directories of 20 directories of 20 files
+mkn::kul::Dir const &walkTree() {
+  static mkn::kul::Dir d("walk.tmp");
+  if (!d.is())
+    for (size_t i = 0; i < 20; i++)
+      for (size_t j = 0; j < 20; j++) {
+        mkn::kul::Dir s(std::to_string(i) + "/" + std::to_string(j), d);
+        s.mk();
+        for (size_t k = 0; k < 20; k++) mkn::kul::io::Writer(mkn::kul::File(std::to_string(k), s));
+      }
+  return d;
+}
+
+void walkDirFiles(benchmark::State &state) {
+  size_t n = 0;
+  while (state.KeepRunning()) n += walkTree().files(true).size();
+  state.SetItemsProcessed(n);
+}
+BENCHMARK(walkDirFiles)->Unit(benchmark::kMillisecond);
+
+void walkFs(benchmark::State &state) {
+  std::atomic<size_t> n{0};
+  mkn::kul::fs::WalkOptions o;
+  o.threads = state.range(0);
+  while (state.KeepRunning())
+    mkn::kul::fs::walk(walkTree(), [&](mkn::kul::fs::Entry const &e) { n += !e.dir(); }, o);
+  state.SetItemsProcessed(n);
+}
+BENCHMARK(walkFs)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond);
+
+template <bool cached>
+void statFiles(benchmark::State &state) {
+  if (cached) mkn::kul::fs::StatCache::INSTANCE().enable();
+  auto const fs = walkTree().files(true);
+  size_t n = 0;
+  while (state.KeepRunning())
+    for (auto const &f : fs) n += f.is() + f.size();
+  state.SetItemsProcessed(state.iterations() * fs.size());
+  mkn::kul::fs::StatCache::INSTANCE().disable();
+  benchmark::DoNotOptimize(n);
+}
+BENCHMARK_TEMPLATE(statFiles, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(statFiles, true)->Unit(benchmark::kMillisecond);
+
+template <mkn::kul::hash::Algo a>
+void hashFile(benchmark::State &state) {
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(mkn::kul::hash::file(lineFile(), a));
+    bytes += lineFile().size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_TEMPLATE(hashFile, mkn::kul::hash::Algo::SHA256)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(hashFile, mkn::kul::hash::Algo::XXH3)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(hashFile, mkn::kul::hash::Algo::BLAKE3)->Unit(benchmark::kMillisecond);
+
+void hashFileCached(benchmark::State &state) {
+  mkn::kul::hash::Cache cache(mkn::kul::File("hashes.tmp"));
+  while (state.KeepRunning()) benchmark::DoNotOptimize(cache.file(lineFile()));
+  cache.clear();
+  cache.save();
+  mkn::kul::File("hashes.tmp").rm();
+}
+BENCHMARK(hashFileCached)->Unit(benchmark::kMicrosecond);
+
+// launching with the argument in MB of touched heap, -D_MKN_KUL_PROC_FORK_ to compare with fork
+void processLaunch(benchmark::State &state) {
+  std::vector<char> heap(size_t(state.range(0)) << 20, 1);
+  while (state.KeepRunning()) {
+    mkn::kul::Process p("true");
+    mkn::kul::ProcessCapture pc(p);
+    p.start();
+  }
+  benchmark::DoNotOptimize(heap.data());
+}
+BENCHMARK(processLaunch)->Arg(16)->Arg(128)->Unit(benchmark::kMicrosecond);
+
+// 64 short children, 8 at a time, on one supervising thread against a thread per child
+void processScheduler(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    mkn::kul::proc::Scheduler s(8);
+    for (size_t i = 0; i < 64; i++) {
+      mkn::kul::Process p("bash");
+      p << "-c"
+        << "\"seq 1 1000\"";
+      s.submit(p);
+    }
+    s.wait();
+  }
+}
+BENCHMARK(processScheduler)->Unit(benchmark::kMillisecond);
+
+void processThreadPool(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    mkn::kul::ConcurrentThreadPool<> pool(8, 1);
+    for (size_t i = 0; i < 64; i++)
+      pool.async([]() {
+        mkn::kul::Process p("bash");
+        mkn::kul::ProcessCapture pc(p);
+        p << "-c"
+          << "\"seq 1 1000\"";
+        p.start();
+      });
+    pool.block().finish().join();
+  }
+}
+BENCHMARK(processThreadPool)->Unit(benchmark::kMillisecond);
+
+// ~15MB of output captured, then read without copying
+void processCapture(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    mkn::kul::Process p("seq");
+    mkn::kul::ProcessCapture pc(p);
+    p << "1"
+      << "2000000";
+    p.start();
+    benchmark::DoNotOptimize(pc.line());
+    benchmark::DoNotOptimize(pc.outs().size());
+  }
+}
+BENCHMARK(processCapture)->Unit(benchmark::kMillisecond);
+
+// a builtin in a persistent shell against a new process each time
+void processWorker(benchmark::State &state) {
+  mkn::kul::proc::Worker sh;
+  while (state.KeepRunning()) benchmark::DoNotOptimize(sh.run("echo hi").out);
+}
+BENCHMARK(processWorker)->Unit(benchmark::kMicrosecond);
+
+void processEcho(benchmark::State &state) {
+  while (state.KeepRunning()) {
+    mkn::kul::Process p("echo");
+    mkn::kul::ProcessCapture pc(p);
+    p << "hi";
+    p.start();
+    benchmark::DoNotOptimize(pc.outs());
+  }
+}
+BENCHMARK(processEcho)->Unit(benchmark::kMicrosecond);
+
 int main(int argc, char **argv) {
   ::benchmark::Initialize(&argc, argv);
   ::benchmark::RunSpecifiedBenchmarks();
+  mkn::kul::File("lines.tmp").rm();
+  mkn::kul::Dir("small.tmp").rm();
+  mkn::kul::Dir("walk.tmp").rm();
 }
@@ -32,13 +32,22 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+#include "mkn/kul/asio/log.hpp"
 #include "mkn/kul/assert.hpp"
 #include "mkn/kul/cli.hpp"
+#include "mkn/kul/cpu.hpp"
+#include "mkn/kul/fs/walk.hpp"
+#include "mkn/kul/hash.hpp"
 #include "mkn/kul/io.hpp"
+#include "mkn/kul/io/uring.hpp"
 #include "mkn/kul/log.hpp"
 #include "mkn/kul/math.hpp"
 #include "mkn/kul/os.hpp"
+#include "mkn/kul/parallel.hpp"
 #include "mkn/kul/proc.hpp"
+#include "mkn/kul/proc/scheduler.hpp"
+#include "mkn/kul/proc/worker.hpp"
+#include "mkn/kul/scm.hpp"
 #include "mkn/kul/threads.hpp"
 #include "mkn/kul/span.hpp"
 #include "mkn/kul/tuple.hpp"
@@ -58,13 +67,19 @@ auto tryCatch = [](std::vector<std::function<void()>> funcs, bool katch) {
 };
 
 #include "test/cli.ipp"
+#include "test/cpu.ipp"
 #include "test/except.ipp"
+#include "test/hash.ipp"
 #include "test/io.ipp"
+#include "test/log.ipp"
 #include "test/math.ipp"
 #include "test/os.ipp"
+#include "test/parallel.ipp"
 #include "test/proc.ipp"
+#include "test/scm.ipp"
 #include "test/string.ipp"
 #include "test/span.ipp"
+#include "test/threads.ipp"
 
 int main(int argc, char *argv[]) {
   KOUT(NON) << __FILE__;
@@ -0,0 +1,32 @@
+TEST(CPU, topology) {
+  auto t = mkn::kul::cpu::topology();
+  EXPECT_GE(t.threads(), (size_t)1);
+  EXPECT_LE(t.cores(), t.threads());
+  EXPECT_LE(t.sockets(), t.cores());
+  EXPECT_GE(t.nodes(), (size_t)1);
+}
+
+TEST(CPU, placement) {
+  using mkn::kul::cpu::Placement;
+  // 2 sockets/nodes of 2 cores with 2 SMT siblings, numbered like most x86 boxes
+  std::vector<mkn::kul::cpu::Cpu> cs(8);
+  for (uint32_t i = 0; i < 8; i++) cs[i] = {i, i % 4, i % 2, i % 2};
+  mkn::kul::cpu::Topology t(std::move(cs));
+  EXPECT_EQ(t.cores(), (size_t)4);
+  EXPECT_EQ(t.sockets(), (size_t)2);
+  using Sets = std::vector<std::vector<uint32_t>>;
+  EXPECT_EQ(mkn::kul::cpu::place(Placement::NONE, 2), Sets(2));
+  EXPECT_EQ(mkn::kul::cpu::place(Placement::COMPACT, 3, t), (Sets{{0}, {4}, {2}}));
+  EXPECT_EQ(mkn::kul::cpu::place(Placement::SCATTER, 5, t), (Sets{{0}, {1}, {2}, {3}, {4}}));
+  EXPECT_EQ(mkn::kul::cpu::place(Placement::PHYSICAL, 3, t), (Sets{{0, 4}, {2, 6}, {1, 5}}));
+  EXPECT_EQ(mkn::kul::cpu::place(Placement::NODE, 3, t),
+            (Sets{{0, 4, 2, 6}, {1, 5, 3, 7}, {0, 4, 2, 6}}));
+}
+
+TEST(CPU, pinnedPool) {
+  std::atomic<size_t> count{0};
+  mkn::kul::WorkStealingPool<> pool(2, 1, mkn::kul::cpu::Placement::COMPACT);
+  for (size_t i = 0; i < 100; i++) pool.async([&]() { count++; });
+  pool.finish().join();
+  EXPECT_EQ(count.load(), (size_t)100);
+}
@@ -0,0 +1,57 @@
+
+TEST(Hash, knownDigests) {
+  using mkn::kul::hash::Algo;
+  using mkn::kul::hash::digest;
+  std::string big(5000, 0);
+  for (size_t i = 0; i < big.size(); i++) big[i] = char(i * 31 + 7);
+  EXPECT_EQ(digest("", Algo::SHA256).hex(),
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  EXPECT_EQ(digest("abc", Algo::SHA256).hex(),
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  EXPECT_EQ(digest(big, Algo::SHA256).hex(),
+            "1e92fd98f113aba0a78e0830ca06e2775912370feab112dfc57bf3258b810595");
+  EXPECT_EQ(digest("", Algo::XXH3).hex(), "2d06800538d394c2");
+  EXPECT_EQ(digest("abc", Algo::XXH3).hex(), "78af5f94892f3950");
+  EXPECT_EQ(digest(big, Algo::XXH3).hex(), "559fff92c2b7f8ee");
+  EXPECT_EQ(digest("", Algo::BLAKE3).hex(),
+            "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+  EXPECT_EQ(digest("abc", Algo::BLAKE3).hex(),
+            "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+  EXPECT_EQ(digest(big, Algo::BLAKE3).hex(),
+            "a3d69d42e4f8b44ec13499a8c2d7bec15bd61e33716dce27a725ae331dc18165");
+
+  mkn::kul::hash::Xxh3 x;
+  mkn::kul::hash::Blake3 b;
+  for (size_t i = 0; i < big.size(); i += 77) {
+    x.update(big.data() + i, std::min<size_t>(77, big.size() - i));
+    b.update(big.data() + i, std::min<size_t>(77, big.size() - i));
+  }
+  EXPECT_EQ(x.digest(), digest(big, Algo::XXH3));
+  EXPECT_EQ(b.digest(), digest(big, Algo::BLAKE3));
+
+  std::string s;
+  mkn::kul::hash::SHA::_256("abc", s);
+  EXPECT_EQ(s, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(Hash, fileCache) {
+  mkn::kul::File const f("hashed.tmp"), c("hashes.tmp");
+  mkn::kul::io::Writer(f) << "abc";
+  {
+    mkn::kul::hash::Cache cache(c);
+    EXPECT_EQ(cache.file(f).hex(), "78af5f94892f3950");
+    EXPECT_EQ(cache.file(f, mkn::kul::hash::Algo::BLAKE3),
+              mkn::kul::hash::file(f, mkn::kul::hash::Algo::BLAKE3));
+    EXPECT_EQ(cache.misses(), (size_t)2);
+  }
+  {
+    mkn::kul::hash::Cache cache(c);  // reloaded from disk
+    EXPECT_EQ(cache.file(f).hex(), "78af5f94892f3950");
+    EXPECT_EQ(cache.hits(), (size_t)1);
+    mkn::kul::io::Writer(f, true) << "d";
+    EXPECT_EQ(cache.file(f), mkn::kul::hash::digest("abcd", mkn::kul::hash::Algo::XXH3));
+    EXPECT_EQ(cache.misses(), (size_t)1);
+  }
+  f.rm();
+  c.rm();
+}
@@ -10,23 +10,132 @@ TEST(IO_Test, ReadFileLine) {
 }
 TEST(IO_Test, ReadFile) {
   char c[20] = {0};
-  bzero(c, 20);
   mkn::kul::File file("LICENSE.md");
   if (!file) KEXCEPT(mkn::kul::Exception, "ReadFile: FileNotFound: ") << file.full();
   mkn::kul::io::Reader r("LICENSE.md");
-  r.read(c, 20);
-  std::string s1 = c;
+  std::string s1(c, r.read(c, 20));
   std::stringstream ss;
-  while ((r.read(c, 20))) {
-    ss << c;
+  while (size_t const n = r.read(c, 20)) {
+    ss << std::string(c, n);
     break;
   }
   EXPECT_EQ("Copyright (c) 2017, ", s1);
   EXPECT_EQ("Philip Deegan.\nAll r", ss.str());
 }
 
-// Travis has a tough time with this one
-#if defined(_MKN_TEST_BINARY_READING_)
+TEST(IO_Test, MappedReaderMatchesReader) {
+  mkn::kul::io::Reader r("LICENSE.md");
+  mkn::kul::io::MappedReader m(mkn::kul::File("LICENSE.md"));
+  size_t lines = 0;
+  for (auto const& l : m.lines()) {
+    char const* c = r.readLine();
+    ASSERT_TRUE(c);
+    EXPECT_EQ(l, c);
+    lines++;
+  }
+  EXPECT_FALSE(r.readLine());
+  EXPECT_GT(lines, (size_t)20);
+  m.seek(0);
+  std::string all;
+  for (auto const& c : m.chunks(7)) all += c;
+  EXPECT_EQ(all, m.data());
+  EXPECT_EQ(all.size(), m.size());
+}
+
+TEST(IO_Test, MappedReaderLineEndings) {
+  mkn::kul::File f("mapped.tmp");
+  {
+    mkn::kul::io::Writer w(f);
+    w.write("a\r\nb\rc\n\nd");
+  }
+  mkn::kul::io::MappedReader m(f);
+  std::vector<std::string> lines;
+  for (auto const& l : m.lines()) lines.emplace_back(l);
+  EXPECT_EQ(lines, (std::vector<std::string>{"a", "b", "c", "", "d"}));
+  f.rm();
+  EXPECT_THROW(mkn::kul::io::MappedReader("mapped.tmp"), mkn::kul::Exception);
+}
+
+TEST(IO_Test, EolScanMatchesScalar) {
+  std::string s(200, 'x');
+  for (size_t i = 0; i < s.size(); i++) {
+    for (char const c : {'\n', '\r'}) {
+      s[i] = c;
+      for (size_t b = 0; b <= i; b += 7)
+        EXPECT_EQ(mkn::kul::io::detail::eol(s.data() + b, s.data() + s.size()), s.data() + i);
+      EXPECT_EQ(mkn::kul::io::detail::eol(s.data(), s.data() + i), s.data() + i);
+      s[i] = 'x';
+    }
+  }
+}
+
+TEST(IO_Test, ReadLineThenRead) {
+  mkn::kul::io::Reader r("LICENSE.md");
+  EXPECT_EQ(std::string(r.readLine()), "Copyright (c) 2017, Philip Deegan.");
+  char c[21] = {0};
+  EXPECT_EQ(r.read(c, 20), (size_t)20);
+  EXPECT_EQ(std::string(c, 20), "All rights reserved.");
+  r.seek(0);
+  EXPECT_EQ(std::string(r.readLine()), "Copyright (c) 2017, Philip Deegan.");
+}
+
+TEST(IO_Test, BufferedWriter) {
+  mkn::kul::File f("buffered.tmp");
+  std::string expected;
+  for (bool const async : {false, true}) {
+    expected.clear();
+    {
+      mkn::kul::io::BufferedWriter w(f, 1, async);  // one BLOCK
+      for (size_t i = 0; i < 5000; i++) {
+        w.line(std::to_string(i));
+        expected += std::to_string(i) + mkn::kul::os::EOL();
+      }
+      std::string const big(3 * mkn::kul::io::BufferedWriter::BLOCK + 5, 'x');
+      w << big << size_t(42) << 'c';
+      expected += big + "42c";
+    }
+    mkn::kul::io::MappedReader m(f);
+    EXPECT_EQ(m.data(), expected);
+  }
+  f.rm();
+}
+
+TEST(IO_Test, UringEngine) {
+  mkn::kul::Dir d("uring.tmp");
+  d.mk();
+  std::vector<mkn::kul::File> files;
+  for (size_t i = 0; i < 300; i++) {
+    files.emplace_back(std::to_string(i), d);
+    mkn::kul::io::Writer(files.back()) << std::string(i * 37, char('a' + i % 26));
+  }
+  files.emplace_back("missing", d);
+  for (bool const native : {true, false}) {
+    mkn::kul::io::uring::Engine e(16, 2, native);
+    if (native && !e.native()) continue;  // no io_uring here
+    std::mutex m;
+    size_t count = 0, errors = 0;
+    e.read(files, [&](mkn::kul::io::uring::Result&& r) {
+      std::lock_guard<std::mutex> l(m);
+      count++;
+      if (r.error) return (void)errors++;
+      auto const i = std::stoul(r.file.name());
+      EXPECT_EQ(r.data.size(), i * 37);
+      EXPECT_EQ(std::string(r.data.begin(), r.data.end()),
+                std::string(i * 37, char('a' + i % 26)));
+    });
+    e.wait();
+    EXPECT_EQ(count, files.size());
+    EXPECT_EQ(errors, (size_t)1);
+
+    mkn::kul::File const w("written", d);
+    std::vector<uint8_t> data(100000, 'w');
+    EXPECT_EQ(e.write(w, std::move(data)).get(), (size_t)100000);
+    EXPECT_EQ(e.read(w).get().size(), (size_t)100000);
+    EXPECT_THROW(e.read(files.back()).get(), mkn::kul::io::Exception);
+  }
+  d.rm();
+}
+
 TEST(IO_Test, ReadBinaryFileLine) {
   mkn::kul::io::BinaryReader r("LICENSE.md");
   const char* c = r.readLine();
@@ -37,18 +146,28 @@ TEST(IO_Test, ReadBinaryFileLine) {
 }
 TEST(IO_Test, ReadBinaryFile) {
   char c[20] = {0};
-  bzero(c, 20);
   mkn::kul::io::BinaryReader r("LICENSE.md");
-  r.read(c, 20);
-  std::string s1 = c;
-  KLOG(INF) << s1.size();
-  KLOG(INF) << strlen(c);
+  std::string s1(c, r.read(c, 20));
   std::stringstream ss;
-  while ((r.read(c, 20))) {
-    ss << c;
+  while (size_t const n = r.read(c, 20)) {
+    ss << std::string(c, n);
     break;
   }
   EXPECT_EQ("Copyright (c) 2017, ", s1);
   EXPECT_EQ("Philip Deegan.\nAll r", ss.str());
+  EXPECT_EQ(std::string(r.readLine()), "ights reserved.");
+  r.seek(10);
+  EXPECT_EQ(std::string(c, r.read(c, 4)), "(c) ");
+}
+TEST(IO_Test, ReadAll) {
+  mkn::kul::File const file("LICENSE.md");
+  auto const all = mkn::kul::io::readAll(file);
+  ASSERT_EQ(all.size(), file.size());
+  mkn::kul::io::MappedReader m(file);
+  EXPECT_EQ(std::string(all.begin(), all.end()), m.data());
+  std::vector<uint8_t> v(all.size() + 10);
+  mkn::kul::io::BinaryReader r(file);
+  EXPECT_EQ(r.read_into(v), all.size());
+  EXPECT_TRUE(std::equal(all.begin(), all.end(), v.begin()));
+  EXPECT_EQ(r.read_into(v), (size_t)0);
 }
-#endif
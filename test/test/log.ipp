@@ -0,0 +1,166 @@
+TEST(Log, compiledFormat) {
+  mkn::kul::Logger logger;
+  std::string st("%%[%M] %L%S %Q %F:%N");
+  logger.str("file.cpp", "fn", 42, "msg", mkn::kul::log::mode::ERR, st, "tid", "time");
+  EXPECT_EQ(st, "%%[ERR] 42msg %Q file.cpp:fn");
+  uint64_t const nanos = uint64_t(1600000000) * 1000000000 + 123456789;
+  std::string const f("%Y-%m-%d-%H:%M:%S:%i");
+  mkn::kul::log::Clock clock(f);
+  EXPECT_EQ(clock.at(nanos), mkn::kul::DateTime::AT(nanos, f));
+  EXPECT_EQ(clock.at(nanos + 1000000), mkn::kul::DateTime::AT(nanos + 1000000, f));
+  EXPECT_EQ(clock.at(nanos + 1000000000), mkn::kul::DateTime::AT(nanos + 1000000000, f));
+}
+
+TEST(Log, disabledOperandsAreNotEvaluated) {
+  size_t evaluated = 0;
+  auto count = [&]() { return ++evaluated; };
+  std::vector<std::string> lines;
+  auto& lm(mkn::kul::LogMan::INSTANCE());
+  lm.setOut([&](std::string const& s) { lines.push_back(s); });
+  lm.setMode(mkn::kul::log::mode::NON);
+  KLOG(INF) << count();
+  EXPECT_EQ(evaluated, (size_t)0);
+  lm.setMode(mkn::kul::log::mode::INF);
+  KLOG(INF) << count();
+  KLOG(ERR) << count();
+  lm.setMode(mkn::kul::log::mode::NON);
+  lm.setOut(nullptr);
+  EXPECT_EQ(evaluated, (size_t)1);
+  EXPECT_EQ(lines.size(), (size_t)1);
+}
+
+TEST(Log, moduleModes) {
+  using namespace mkn::kul::log;
+  struct Man : mkn::kul::ALogMan {
+    Man() : ALogMan(new mkn::kul::Logger()) {}
+  } man;
+  EXPECT_TRUE(man.setMode("ERR, log:DBG ,nix/other.cpp:OFF"));
+  EXPECT_TRUE(man.enabled("test/test/log.ipp", mode::DBG));
+  EXPECT_FALSE(man.enabled("test/test/log.ipp", mode::OTH));
+  EXPECT_TRUE(man.enabled("inc/proc.hpp", mode::ERR));
+  EXPECT_FALSE(man.enabled("inc/proc.hpp", mode::DBG));
+  EXPECT_FALSE(man.enabled("src/nix/other.cpp", mode::NON));
+  EXPECT_TRUE(man.enabled("src/win/other.cpp", mode::ERR));
+  man.setMode("log", mode::INF);
+  EXPECT_FALSE(man.enabled("test/test/log.ipp", mode::DBG));
+  EXPECT_FALSE(man.setMode("io:LOUD"));
+  EXPECT_TRUE(man.enabled("inc/proc.hpp", mode::ERR));
+}
+
+TEST(Log, binaryRoundTrip) {
+  std::string bin;
+  mkn::kul::log::bin::Writer w([&](char const* s, size_t n) { bin.append(s, n); });
+  for (size_t i = 0; i < 2; i++) {
+    std::string args;
+    mkn::kul::log::arg(args, "i=");
+    mkn::kul::log::arg(args, i);
+    mkn::kul::log::arg(args, ' ');
+    mkn::kul::log::arg(args, -1.25);
+    w.log("file.cpp", "fn", 7, mkn::kul::log::mode::INF, args);
+  }
+  std::string out;
+  mkn::kul::log::bin::Decoder d("[%M] %T %F fn(%N)#%L - %S");
+  for (auto const& c : bin) d.decode(&c, 1, out);  // records split across reads
+  EXPECT_FALSE(d.partial());
+  auto const tid = mkn::kul::this_thread::id(), eol = std::string(mkn::kul::os::EOL());
+  EXPECT_EQ(out, "[INF] " + tid + " file.cpp fn(fn)#7 - i=0 -1.25" + eol + "[INF] " + tid +
+                     " file.cpp fn(fn)#7 - i=1 -1.25" + eol);
+  EXPECT_THROW(mkn::kul::log::bin::Decoder().decode("text!", 5, out), mkn::kul::Exception);
+}
+
+TEST(AsioLog, manyThreadsInOrderPerThread) {
+  std::mutex m;
+  std::vector<std::string> lines;
+  {
+    mkn::kul::asio::Logger logger;
+    logger.setOut([&](std::string const& s) {
+      std::lock_guard<std::mutex> l(m);
+      lines.push_back(s);
+    });
+    std::vector<std::thread> ts;
+    for (size_t t = 0; t < 3; t++)
+      ts.emplace_back([&, t]() {
+        for (size_t i = 0; i < 1000; i++) logger.out(std::to_string(t) + ":" + std::to_string(i));
+      });
+    for (auto& t : ts) t.join();
+    logger.out(std::string(1000, 'x'));
+    logger.flush();
+  }
+  ASSERT_EQ(lines.size(), (size_t)3001);
+  EXPECT_EQ(lines.back(), std::string(1000, 'x'));
+  std::vector<size_t> next(3, 0);
+  for (size_t i = 0; i < 3000; i++) {
+    auto t = lines[i][0] - '0';
+    EXPECT_EQ(lines[i], std::to_string(t) + ":" + std::to_string(next[t]++));
+  }
+}
+
+TEST(AsioLog, backPressure) {
+  using mkn::kul::asio::log::Policy;
+  for (auto const& p : {Policy::DROP_NEWEST, Policy::DROP_OLDEST}) {
+    std::vector<std::string> lines;
+    mkn::kul::asio::Logger logger(p, 4, 0);
+    logger.setOut([&](std::string const& s) { lines.push_back(s); });
+    for (size_t i = 0; i < 10; i++) logger.out(std::to_string(i));
+    logger.flush();
+    EXPECT_EQ(logger.dropped(), (size_t)6);
+    std::vector<std::string> const expected =
+        p == Policy::DROP_NEWEST ? std::vector<std::string>{"0", "1", "2", "3"}
+                                 : std::vector<std::string>{"6", "7", "8", "9"};
+    EXPECT_EQ(lines, expected);
+  }
+}
+
+#if !KUL_IS_WIN
+TEST(AsioLog, flushOnCrash) {
+  EXPECT_EXIT(
+      {
+        {  // drained by its destructor, after which the hook must not reach it
+          mkn::kul::asio::Logger gone(mkn::kul::asio::log::Policy::BLOCK, 4, 0);
+          gone.err("gone");
+          gone.flushOnCrash();
+        }
+        mkn::kul::asio::Logger logger(mkn::kul::asio::log::Policy::BLOCK, 4, 0);
+        logger.err("undrained");
+        logger.flushOnCrash();
+        raise(SIGABRT);
+      },
+      ::testing::ExitedWithCode(SIGABRT), "^goneundrained$");
+}
+#endif
+
+TEST(AsioLog, deferredMatchesEager) {
+  struct Point {
+    int x, y;
+  };
+  std::vector<std::string> lines;
+  mkn::kul::asio::Logger logger;
+  logger.setOut([&](std::string const& s) { lines.push_back(s); });
+  std::string b;
+  mkn::kul::asio::log::header(b, "file.cpp", "fn", 7, mkn::kul::log::mode::INF);
+  auto const now = mkn::kul::Now::NANOS();
+  std::memcpy(&b[0], &now, sizeof(now));
+  std::string const s("s");
+  char const* p = nullptr;
+  mkn::kul::asio::log::arg(b, "a");
+  mkn::kul::asio::log::arg(b, s);
+  mkn::kul::asio::log::arg(b, -2);
+  mkn::kul::asio::log::arg(b, size_t(3));
+  mkn::kul::asio::log::arg(b, 1.5);
+  mkn::kul::asio::log::arg(b, 'c');
+  mkn::kul::asio::log::arg(b, std::string_view("v"));
+  mkn::kul::asio::log::arg(b, static_cast<void const*>(p));
+  logger.defer(b);
+  logger.flush();
+  ASSERT_EQ(lines.size(), (size_t)1);
+  std::stringstream ss;
+  ss << "as" << -2 << size_t(3) << 1.5 << 'c' << "v" << static_cast<void const*>(p);
+  std::string st(__MKN_KUL_LOG_FRMT__);
+  logger.str("file.cpp", "fn", 7, ss.str(), mkn::kul::log::mode::INF, st,
+             mkn::kul::this_thread::id(), mkn::kul::DateTime::AT(now, __MKN_KUL_LOG_TIME_FRMT__));
+  EXPECT_EQ(lines[0], st + mkn::kul::os::EOL());
+  b.resize(b.size() - 1);  // truncated records are discarded
+  logger.defer(b);
+  logger.flush();
+  EXPECT_EQ(lines.size(), (size_t)1);
+}
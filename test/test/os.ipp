@@ -34,3 +34,96 @@ TEST(OperatingSystemTests, HasFileModifiedTimeStampSupport) {
   ASSERT_TRUE(TimeStampHandler::INSTANCE().is());
   ASSERT_TRUE(TimeStampHandler::INSTANCE().timeStamps().modified());
 }
+
+TEST(OperatingSystemTests, GlobMatch) {
+  using mkn::kul::fs::match;
+  EXPECT_TRUE(match("*.cpp", "a.cpp"));
+  EXPECT_FALSE(match("*.cpp", "a/b.cpp"));
+  EXPECT_TRUE(match("**/*.cpp", "a/b/c.cpp"));
+  EXPECT_TRUE(match("**/*.cpp", "c.cpp"));
+  EXPECT_TRUE(match("a/**/b", "a/b"));
+  EXPECT_TRUE(match("?.[ch]pp", "x.hpp"));
+  EXPECT_FALSE(match("?.[!ch]pp", "x.hpp"));
+  EXPECT_TRUE(match("[a-c]*", "build"));
+  EXPECT_FALSE(match("[a-c]*", "dist"));
+  EXPECT_TRUE(match("[x", "[x"));
+}
+
+TEST(OperatingSystemTests, Walk) {
+  mkn::kul::Dir d("walk.tmp");
+  d.mk();
+  for (auto const s : {"a", "a/b", "a/b/c", ".hid", "skip"}) mkn::kul::Dir(s, d).mk();
+  for (auto const s : {"1.cpp", "a/2.cpp", "a/b/3.hpp", "a/b/c/4.cpp", ".hid/5.cpp", "skip/6.cpp",
+                       ".7.cpp"})
+    mkn::kul::io::Writer(mkn::kul::File(s, d)) << s;
+
+  for (size_t const threads : {1, 3}) {
+    std::mutex m;
+    std::set<std::string> found, dirs;
+    mkn::kul::fs::WalkOptions o;
+    o.threads = threads;
+    o.include = {"*.cpp"};
+    o.exclude = {"skip"};
+    mkn::kul::fs::walk(d, [&](mkn::kul::fs::Entry const& e) {
+      std::lock_guard<std::mutex> l(m);
+      (e.dir() ? dirs : found).emplace(e.relative());
+    }, o);
+    EXPECT_EQ(found, (std::set<std::string>{"1.cpp", "a/2.cpp", "a/b/c/4.cpp"}));
+    EXPECT_EQ(dirs, (std::set<std::string>{"a", "a/b", "a/b/c"}));
+
+    found.clear();
+    o.include = {"a/**"};
+    o.exclude.clear();
+    o.hidden = 1;
+    mkn::kul::fs::walk(d, [&](mkn::kul::fs::Entry const& e) {
+      std::lock_guard<std::mutex> l(m);
+      if (!e.dir()) found.emplace(e.relative());
+      return e.name() != "b";
+    }, o);
+    EXPECT_EQ(found, (std::set<std::string>{"a/2.cpp"}));
+  }
+
+  size_t n = 0;
+  mkn::kul::fs::WalkOptions o;
+  o.threads = 1;
+  o.hidden = 1;
+  mkn::kul::fs::walk(d, [&](mkn::kul::fs::Entry const& e) { n += !e.dir(); }, o);
+  EXPECT_EQ(n, d.files(true).size() + 1);  // files() does not descend hidden directories
+  mkn::kul::Dir(".hid", d).rm();  // nor does rm()
+  d.rm();
+}
+
+TEST(OperatingSystemTests, StatCache) {
+  auto& cache = mkn::kul::fs::StatCache::INSTANCE();
+  if (!cache.enable()) return;  // no inotify
+  mkn::kul::Dir d("stat.tmp/a/b");
+  EXPECT_FALSE(d.is());
+  d.mk();
+  EXPECT_TRUE(d.is());
+  mkn::kul::File f("f", d);
+  EXPECT_FALSE(f.is());
+  mkn::kul::io::Writer(f) << "1234";
+  EXPECT_TRUE(f.is());
+  EXPECT_EQ(f.size(), (uint64_t)4);
+  auto const hits = cache.hits();
+  EXPECT_TRUE(f.is());
+  EXPECT_EQ(f.size(), (uint64_t)4);
+  EXPECT_GT(cache.hits(), hits);
+
+  mkn::kul::io::Writer(f, true) << "5678";  // append
+  EXPECT_EQ(f.size(), (uint64_t)8);
+
+  auto const real = f.real();
+  EXPECT_EQ(std::rename("stat.tmp/a", "stat.tmp/c"), 0);  // above the watched directory
+  EXPECT_FALSE(f.is());
+  EXPECT_FALSE(d.is());
+  EXPECT_THROW(mkn::kul::Dir::REAL(real), mkn::kul::fs::Exception);
+  mkn::kul::File g("f", mkn::kul::Dir("stat.tmp/c/b"));
+  EXPECT_TRUE(g.is());
+  g.rm();
+  EXPECT_FALSE(g.is());
+  cache.disable();
+  EXPECT_FALSE(mkn::kul::fs::StatCache::ENABLED());
+  mkn::kul::Dir("stat.tmp").rm();
+  EXPECT_FALSE(mkn::kul::Dir("stat.tmp").is());
+}
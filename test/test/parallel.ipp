@@ -0,0 +1,39 @@
+TEST(Parallel, forEachElementAndIndex) {
+  mkn::kul::WorkStealingPool<> pool(3, 1);
+  std::vector<size_t> v(10000, 1);
+  mkn::kul::parallel_for(pool, v, [](size_t& e) { e *= 2; });
+  EXPECT_EQ(std::accumulate(v.begin(), v.end(), size_t{0}), (size_t)20000);
+  mkn::kul::Span<size_t> span(v);
+  mkn::kul::parallel_for(pool, span.size(), [&](size_t i) { span[i] = i; }, 100);
+  for (size_t i = 0; i < v.size(); i++) EXPECT_EQ(v[i], i);
+  pool.finish().join();
+}
+
+TEST(Parallel, reduceIsRepeatable) {
+  mkn::kul::WorkStealingPool<> pool(4, 1);
+  std::vector<double> v(100000);
+  for (size_t i = 0; i < v.size(); i++) v[i] = 1.0 / (i + 1);
+  auto sum = [](double a, double b) { return a + b; };
+  auto r = mkn::kul::parallel_reduce(pool, v, 0.0, sum);
+  for (size_t i = 0; i < 10; i++) EXPECT_EQ(mkn::kul::parallel_reduce(pool, v, 0.0, sum), r);
+  EXPECT_NEAR(r, std::accumulate(v.begin(), v.end(), 0.0), 1e-9);
+  EXPECT_EQ(mkn::kul::parallel_reduce(pool, std::vector<double>{}, 1.0, sum), 1.0);
+  pool.finish().join();
+}
+
+TEST(Parallel, transformAndExceptions) {
+  mkn::kul::ConcurrentThreadPool<> pool(2, 1, 1000);
+  std::vector<int> in(1000), out(1000);
+  std::iota(in.begin(), in.end(), 0);
+  mkn::kul::parallel_transform(pool, in, out, [](int i) { return i * 3; });
+  for (size_t i = 0; i < in.size(); i++) EXPECT_EQ(out[i], in[i] * 3);
+  EXPECT_THROW(mkn::kul::parallel_for(pool, in,
+                                      [](int i) {
+                                        if (i == 500) KEXCEPT(mkn::kul::Exception, "500");
+                                      }),
+               mkn::kul::Exception);
+  std::vector<int> small(10);
+  EXPECT_THROW(mkn::kul::parallel_transform(pool, in, small, [](int i) { return i; }),
+               mkn::kul::Exception);
+  pool.block().finish(1000).join();
+}
@@ -34,3 +34,184 @@ TEST(Process_Test, CaptureProcess) {
   } catch (...) {
   }
 }
+
+TEST(Process_Test, SpawnEnvironmentAndDirectory) {
+  mkn::kul::Dir d("proc.tmp");
+  d.mk();
+  mkn::kul::Process p("bash", d);
+  mkn::kul::ProcessCapture pc(p);
+  p << "-c"
+    << "\"echo $KUL_SPAWN_TEST $HOME && pwd\"";
+  p.var("KUL_SPAWN_TEST", "set");
+  p.start();
+  EXPECT_EQ(pc.outs(), "set " + mkn::kul::env::GET("HOME") + "\n" + d.real() + "\n");
+  d.rm();
+
+  mkn::kul::Process m("kul_no_such_binary");
+  mkn::kul::ProcessCapture mc(m);
+  EXPECT_THROW(m.start(), mkn::kul::Exception);
+
+  mkn::kul::Process e("bash");  // PATH given to the process is searched
+  mkn::kul::ProcessCapture ec(e);
+  e << "-c"
+    << "\"exit 3\"";
+  e.var("PATH", "/usr/bin:/bin");
+  try {
+    e.start();
+  } catch (mkn::kul::proc::ExitException const& ex) {
+    EXPECT_EQ(ex.code(), 3);
+  }
+  EXPECT_EQ(e.exitCode(), 3);
+}
+
+class ExpandingProcess : public mkn::kul::Process {
+ public:
+  ExpandingProcess(std::string const& cmd) : mkn::kul::Process(cmd) {}
+
+ protected:
+  void expand(std::string& s) const override { mkn::kul::String::REPLACE_ALL(s, "@@", "expanded"); }
+};
+
+TEST(Process_Test, ExpandOverride) {
+  ExpandingProcess p("echo");
+  mkn::kul::ProcessCapture pc(p);
+  p << "@@";
+  p.start();
+  EXPECT_EQ(pc.outs(), "expanded\n");
+}
+
+TEST(Process_Test, PollLargeAndQuietOutput) {
+  mkn::kul::Process p("bash");
+  mkn::kul::ProcessCapture pc(p);
+  p << "-c"
+    << "\"seq 1 200000 && echo done >&2\"";
+  p.start();
+  auto lines = mkn::kul::String::LINES(pc.outs());
+  ASSERT_EQ(lines.size(), (size_t)200000);
+  EXPECT_EQ(lines.back(), "200000");
+  EXPECT_EQ(pc.errs(), "done\n");
+
+  mkn::kul::Process q("bash");  // the parent waits without output arriving
+  mkn::kul::ProcessCapture qc(q);
+  q << "-c"
+    << "\"sleep 0.2 && exit 2\"";
+  auto const now = mkn::kul::Now::MILLIS();
+  EXPECT_THROW(q.start(), mkn::kul::proc::ExitException);
+  EXPECT_GE(mkn::kul::Now::MILLIS() - now, (uint64_t)200);
+  EXPECT_EQ(q.exitCode(), 2);
+  EXPECT_FALSE(qc.outs().size());
+}
+
+TEST(Process_Test, Scheduler) {
+  std::vector<mkn::kul::Future<mkn::kul::proc::Result>> fs;
+  std::string flags;
+  {
+    mkn::kul::proc::Scheduler s(3);
+    for (size_t i = 0; i < 20; i++) {
+      mkn::kul::Process p("bash");
+      p << "-c"
+        << "\"echo " + std::to_string(i) + " && echo e >&2 && exit " + std::to_string(i % 3) +
+               "\"";
+      fs.emplace_back(s.submit(p));
+    }
+    mkn::kul::Process m("bash");
+    m << "-c"
+      << "\"echo $MAKEFLAGS\"";
+    flags = s.submit(m).get().out;
+    auto missing = s.submit(mkn::kul::Process("kul_no_such_binary"));
+#if defined(_MKN_KUL_PROC_FORK_)
+    EXPECT_NE(missing.get().code, 0);  // the forked child fails to exec
+#else
+    EXPECT_THROW(missing.get(), mkn::kul::Exception);
+#endif
+    s.wait();
+
+    auto js = mkn::kul::proc::JobServer::JOIN(flags);  // every token is back once idle
+    ASSERT_TRUE(js);
+    char t;
+    size_t n = 0;
+    while (js->acquire(t)) n++;
+    EXPECT_EQ(n, (size_t)2);
+    for (size_t i = 0; i < n; i++) js->release(t);
+  }
+  EXPECT_NE(flags.find("-j3 --jobserver-auth="), std::string::npos);
+
+  {  // all slots are used once the first job has finished, two rounds not three
+    mkn::kul::proc::Scheduler s(3);
+    auto const now = mkn::kul::Now::MILLIS();
+    for (size_t i = 0; i < 6; i++) {
+      mkn::kul::Process p("sleep");
+      p << "0.3";
+      s.submit(p);
+    }
+    s.wait();
+    EXPECT_LT(mkn::kul::Now::MILLIS() - now, (uint64_t)850);
+  }
+  for (size_t i = 0; i < fs.size(); i++) {
+    auto const r = fs[i].get();
+    EXPECT_EQ(r.out, std::to_string(i) + "\n");
+    EXPECT_EQ(r.err, "e\n");
+    EXPECT_EQ(r.code, int32_t(i % 3));
+  }
+}
+
+TEST(Process_Test, CaptureLinesCapAndTake) {
+  std::vector<std::string> lines;
+  mkn::kul::Process p("bash");
+  mkn::kul::ProcessCapture pc(p);
+  pc.lines([&](std::string_view const& l) { lines.emplace_back(l); });
+  p << "-c"
+    << "\"seq 1 50000 && printf last && echo e >&2\"";
+  p.start();
+  EXPECT_EQ(pc.outs(), "last");
+  pc.flush();
+  ASSERT_EQ(lines.size(), (size_t)50001);
+  EXPECT_EQ(lines[0], "1");
+  EXPECT_EQ(lines[49999], "50000");
+  EXPECT_EQ(lines.back(), "last");
+  EXPECT_TRUE(pc.outs().empty());
+  EXPECT_EQ(pc.errs(), "e\n");
+
+  mkn::kul::Process c("bash");
+  mkn::kul::ProcessCapture cc(c);
+  cc.cap(10);
+  c << "-c"
+    << "\"echo && seq 1 10000\"";
+  c.start();
+  EXPECT_EQ(cc.outs(), "\n1\n2\n3\n4\n5");
+  EXPECT_TRUE(cc.truncated());
+  EXPECT_EQ(cc.line(), "1");
+  auto const s = cc.takeOuts();
+  EXPECT_EQ(s.size(), (size_t)10);
+  EXPECT_TRUE(cc.outs().empty());
+}
+
+TEST(Process_Test, Worker) {
+  mkn::kul::proc::Worker sh;
+  auto r = sh.run("echo hi && printf no_newline >&2 && false");
+  EXPECT_EQ(r.out, "hi\n");
+  EXPECT_EQ(r.err, "no_newline");
+  EXPECT_EQ(r.code, 1);
+  auto const pid = sh.pid();
+
+  std::vector<std::string> cmds{"cd /", "pwd", "echo \"it's\"", "echo \"unbalanced", "exit 4"};
+  auto rs = sh.run(std::vector<std::string>(cmds.begin(), cmds.end() - 1));
+  ASSERT_EQ(rs.size(), (size_t)4);
+  EXPECT_EQ(rs[1].out, "/\n");
+  EXPECT_EQ(rs[2].out, "it's\n");
+  EXPECT_NE(rs[3].code, 0);
+  EXPECT_TRUE(rs[3].err.size());
+  EXPECT_EQ(sh.pid(), pid);
+
+  EXPECT_THROW(sh.run(cmds.back()), mkn::kul::Exception);
+  EXPECT_EQ(sh.run("seq 1 100000").out.size(), (size_t)588895);
+  EXPECT_NE(sh.pid(), pid);
+
+  mkn::kul::proc::Worker cat({"cat"}, [](std::string_view const& b) -> size_t {
+    auto const nl = b.find('\n');
+    return nl == std::string_view::npos ? 0 : nl + 1;
+  });
+  auto const outs = cat.request(std::vector<std::string>{"a\n", "b\n", "c\n"});
+  EXPECT_EQ(outs, (std::vector<std::string>{"a\n", "b\n", "c\n"}));
+  EXPECT_EQ(cat.request("d\n"), "d\n");
+}
@@ -0,0 +1,35 @@
+
+TEST(SCM, GitBatches) {
+  mkn::kul::Dir d("scm.tmp");
+  d.mk();
+  mkn::kul::proc::Worker sh;
+  auto const git = "git -c user.name=kul -c user.email=kul@kul -C " + d.real() + " ";
+  auto const setup = sh.run(std::vector<std::string>{
+      git + "init -q", git + "checkout -q -b main", git + "commit -q --allow-empty -m a",
+      git + "branch dev", git + "rev-parse HEAD"});
+  for (auto const& r : setup) ASSERT_EQ(r.code, 0) << r.err;
+  auto const head = setup.back().out.substr(0, 40);
+
+  mkn::kul::scm::Git g;
+  auto st = g.status_many({d.real(), "scm.tmp/missing"}, 2);
+  EXPECT_FALSE(st.ok());
+  EXPECT_TRUE(st.errors[0].empty());
+  EXPECT_EQ(st.values[0].branch, "main");
+  EXPECT_EQ(st.values[0].version, head);
+  EXPECT_FALSE(st.values[0].changes);
+  EXPECT_FALSE(st.errors[1].empty());
+  EXPECT_THROW(st.raise(), mkn::kul::scm::Exception);
+
+  mkn::kul::File("f", d).mk();
+  EXPECT_TRUE(g.status_many({d.real()}).values[0].changes);
+
+  auto rv = g.remoteVersion_many(
+      {{d.real(), "main"}, {d.real(), "dev"}, {d.real(), "nope"}, {"scm.tmp/none", "main"}});
+  EXPECT_EQ(rv.values[0], head);
+  EXPECT_EQ(rv.values[1], head);
+  EXPECT_EQ(rv.values[0], g.remoteVersion(d.real(), "main"));
+  EXPECT_NE(rv.errors[2].find("MAY NOT EXIST"), std::string::npos);
+  EXPECT_FALSE(rv.errors[3].empty());
+  EXPECT_EQ(g.remoteVersion_many({{d.real(), ""}}).values[0], head);
+  sh.run("rm -rf " + d.real());
+}
@@ -0,0 +1,181 @@
+
+TEST(WorkStealingPool, runsAllTasks) {
+  std::atomic<size_t> count{0};
+  mkn::kul::WorkStealingPool<> pool(3, 1);
+  for (size_t i = 0; i < 10000; i++) pool.async([&]() { count++; });
+  pool.block().finish().join();
+  EXPECT_EQ(count.load(), (size_t)10000);
+}
+
+TEST(WorkStealingPool, nestedTasksAreStolen) {
+  std::atomic<size_t> count{0};
+  mkn::kul::WorkStealingPool<> pool(4, 1);
+  for (size_t i = 0; i < 100; i++)
+    pool.async([&]() {
+      for (size_t j = 0; j < 100; j++) pool.async([&]() { count++; });
+    });
+  pool.finish().join();
+  EXPECT_EQ(count.load(), (size_t)10000);
+}
+
+TEST(WorkStealingPool, exceptions) {
+  std::atomic<size_t> handled{0};
+  mkn::kul::WorkStealingPool<> pool(2, 1);
+  pool.async([]() { KEXCEPT(mkn::kul::Exception, "handled"); },
+             [&](mkn::kul::Exception const&) { handled++; });
+  pool.async([]() { KEXCEPT(mkn::kul::Exception, "unhandled"); });
+  pool.finish().join();
+  EXPECT_EQ(handled.load(), (size_t)1);
+  EXPECT_THROW(pool.rethrow(), mkn::kul::Exception);
+}
+
+TEST(Future, submitThenWhenAll) {
+  mkn::kul::WorkStealingPool<> pool(2, 1);
+  std::vector<mkn::kul::Future<size_t>> fs;
+  for (size_t i = 0; i < 100; i++)
+    fs.emplace_back(pool.submit([](size_t a, size_t b) { return a * b; }, i, 2).then([](size_t v) {
+      return v + 1;
+    }));
+  auto all = mkn::kul::when_all(std::move(fs)).get();
+  ASSERT_EQ(all.size(), (size_t)100);
+  for (size_t i = 0; i < all.size(); i++) EXPECT_EQ(all[i], i * 2 + 1);
+  pool.finish().join();
+}
+
+TEST(Future, nestedGetOnSingleWorker) {
+  mkn::kul::WorkStealingPool<> pool(1, 1);
+  auto f = pool.submit([&]() {
+    auto inner = pool.submit([]() { return std::string("inner"); });
+    return inner.get() + "outer";
+  });
+  EXPECT_EQ(f.get(), "innerouter");
+  pool.finish().join();
+}
+
+TEST(Future, exceptionsPropagate) {
+  mkn::kul::ConcurrentThreadPool<> pool(2, 1);
+  auto f = pool.submit([]() -> int { KEXCEPT(mkn::kul::Exception, "submit"); }).then([](int i) {
+    return i + 1;
+  });
+  EXPECT_THROW(f.get(), mkn::kul::Exception);
+  auto v = pool.submit([]() {});
+  v.get();
+  pool.block().finish().join();
+}
+
+TEST(Future, continuationsRunAfterBlock) {
+  mkn::kul::ConcurrentThreadPool<> pool(2, 1);
+  auto slow = [](size_t i) {
+    mkn::kul::this_thread::sleep(50);
+    return i;
+  };
+  auto f = pool.submit(slow, 1).then([](size_t v) { return v + 1; });
+  std::vector<mkn::kul::Future<size_t>> fs;
+  for (size_t i = 0; i < 4; i++) fs.emplace_back(pool.submit(slow, i));
+  auto all = mkn::kul::when_all(std::move(fs)).then([](std::vector<size_t> v) {
+    return std::accumulate(v.begin(), v.end(), size_t(0));
+  });
+  pool.block().finish().join();
+  EXPECT_EQ(f.get(), (size_t)2);
+  EXPECT_EQ(all.get(), (size_t)6);
+  EXPECT_THROW(pool.submit(slow, 0).get(), mkn::kul::threading::FutureException);
+}
+
+TEST(Future, discardedWhenPoolDestroyed) {
+  auto slow = [](size_t i) {
+    mkn::kul::this_thread::sleep(10);
+    return i;
+  };
+  mkn::kul::Future<size_t> f, c;
+  {
+    mkn::kul::ConcurrentThreadPool<> pool(1, 1);
+    for (size_t i = 0; i < 50; i++) pool.submit(slow, i);
+    f = pool.submit(slow, 50);
+    c = pool.submit(slow, 51).then([](size_t v) { return v + 1; });
+  }
+  EXPECT_THROW(f.get(), mkn::kul::threading::FutureException);
+  EXPECT_THROW(c.get(), mkn::kul::threading::FutureException);
+}
+
+TEST(Future, whenAllWithException) {
+  mkn::kul::Promise<int> a, b;
+  std::vector<mkn::kul::Future<int>> fs;
+  fs.emplace_back(a.future());
+  fs.emplace_back(b.future());
+  auto all = mkn::kul::when_all(std::move(fs));
+  a.except(std::make_exception_ptr(mkn::kul::Exception(__FILE__, __LINE__, "a")));
+  b.set(1);
+  EXPECT_THROW(all.get(), mkn::kul::Exception);
+}
+
+TEST(Task, inlineAndHeapStorage) {
+  size_t count = 0;
+  mkn::kul::Task<void()> small([&count]() { count++; });
+  std::array<size_t, 32> big{};
+  big[31] = 2;
+  mkn::kul::Task<void()> large([&count, big]() { count += big[31]; });
+  auto moved(std::move(large));
+  EXPECT_FALSE(large);
+  small();
+  moved();
+  EXPECT_EQ(count, (size_t)3);
+  mkn::kul::Task<size_t(size_t)> twice([](size_t i) { return i * 2; });
+  EXPECT_EQ(twice(4), (size_t)8);
+  EXPECT_FALSE(mkn::kul::Task<void()>(std::function<void()>()));
+  small = nullptr;
+  EXPECT_THROW(small(), std::bad_function_call);
+}
+
+TEST(Task, queueIsFifo) {
+  mkn::kul::threading::TaskQueue<mkn::kul::Task<size_t()>> q;
+  for (size_t i = 0; i < 3; i++) q.push([i]() { return i; });
+  EXPECT_EQ(q.size(), (size_t)3);
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_EQ(q.front()(), i);
+    q.pop();
+  }
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(MPMCQueue, boundedAndFifo) {
+  mkn::kul::MPMCQueue<size_t, 4> q;
+  for (size_t i = 0; i < 4; i++) EXPECT_TRUE(q.try_push(i));
+  EXPECT_FALSE(q.try_push(4));
+  EXPECT_EQ(q.size(), (size_t)4);
+  size_t v = 0;
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_TRUE(q.try_pop(v));
+    EXPECT_EQ(v, i);
+  }
+  EXPECT_FALSE(q.try_pop(v));
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(MPMCQueue, manyProducersManyConsumers) {
+  mkn::kul::MPMCQueue<size_t, 64> q;
+  std::atomic<size_t> sum{0}, popped{0};
+  size_t const n = 10000;
+  std::vector<std::thread> ts;
+  for (size_t t = 0; t < 3; t++)
+    ts.emplace_back([&]() {
+      for (size_t i = 1; i <= n; i++) q.push(i);
+    });
+  for (size_t t = 0; t < 3; t++)
+    ts.emplace_back([&]() {
+      size_t v;
+      while (popped < n * 3)
+        if (q.try_pop(v)) sum += v, popped++;
+    });
+  for (auto& t : ts) t.join();
+  EXPECT_EQ(sum.load(), 3 * n * (n + 1) / 2);
+}
+
+TEST(MPMCQueue, backsConcurrentThreadPool) {
+  std::atomic<size_t> count{0};
+  mkn::kul::ConcurrentThreadPool<mkn::kul::Exception, mkn::kul::PoolThread,
+                                 mkn::kul::threading::LockFree<16>>
+      pool(2, 1, 1000);
+  for (size_t i = 0; i < 100; i++) pool.async([&]() { count++; });
+  pool.block().finish(1000).join();
+  EXPECT_EQ(count.load(), (size_t)100);
+}
@@ -0,0 +1,62 @@
+/**
+Copyright (c) 2017, Philip Deegan.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+    * Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+copyright notice, this list of conditions and the following disclaimer
+in the documentation and/or other materials provided with the
+distribution.
+    * Neither the name of Philip Deegan nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// renders binary logs written with KLOG_BIN or LogMan::setBinary back to text
+//  usage: klog [file] [format], reads stdin if no file or "-" is given
+
+#include "mkn/kul/log.hpp"
+
+#include <cstdio>
+
+int main(int argc, char *argv[]) {
+  FILE *in = stdin;
+  if (argc > 1 && std::string(argv[1]) != "-" && !(in = fopen(argv[1], "rb"))) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+  try {
+    mkn::kul::log::bin::Decoder d(argc > 2 ? argv[2] : __MKN_KUL_LOG_FRMT__);
+    char b[1 << 16];
+    std::string out;
+    size_t n;
+    while ((n = fread(b, 1, sizeof(b), in))) {
+      out.clear();
+      d.decode(b, n, out);
+      fwrite(out.data(), 1, out.size(), stdout);
+    }
+    if (d.partial()) fprintf(stderr, "Binary log ends with an incomplete record\n");
+  } catch (const mkn::kul::Exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  if (in != stdin) fclose(in);
+  return 0;
+}